@@ -4,12 +4,64 @@
 struct AIO;
 struct AIOCmdBuffer;
 
-AIO *aioCreate(size_t _size);
+// The pool backend runs pread/pwrite on worker threads, for filesystems without native asynchronous I/O
+enum AIOBackend { AIOBackend_Libaio = 0, AIOBackend_Uring, AIOBackend_Pool, AIOBackend_Count };
+enum AIOFileMode { AIOFileMode_Read = 0, AIOFileMode_Write, AIOFileMode_Count };
+
+AIO *aioCreate(size_t _size, AIOBackend _backend = AIOBackend_Libaio);
 void aioDestroy(AIO *_aio);
 
+bool aioRegisterBuffer(AIO *_aio, void *_buffer, size_t _size);
+
+// Direct I/O bypasses the page cache for the block aligned part of each transfer, set it before opening files
+void aioSetDirect(AIO *_aio, bool _direct);
+
+// Transfers larger than twice the chunk size are striped over several commands to keep the device queue busy,
+// the chunks complete as a single transfer. Zero disables striping, the default is AIO_DEFAULT_CHUNK
+const size_t AIO_DEFAULT_CHUNK = 1 << 20;
+void aioSetChunkSize(AIO *_aio, size_t _chunk);
+
+// Write-behind starts the writeback of buffered writes as soon as they complete and waits for the oldest ones,
+// dropping them from the page cache, once more than the budget is dirty. Zero disables it
+const size_t AIO_DEFAULT_WRITE_BEHIND = 64 << 20;
+void aioSetWriteBehind(AIO *_aio, size_t _budget);
+
+// Queue depth controller: the number of outstanding commands grows while the throughput follows and shrinks once
+// the completion latency climbs past the knee of its lowest value. Disabled, the whole queue size is used
+struct AIOCounters
+{
+	size_t depth;
+	size_t peakDepth;
+	int grows;
+	int shrinks;
+	int windows;
+	int throttled;
+	double throughput;
+	double latency;
+	double baseline;
+};
+void aioSetAdaptiveDepth(AIO *_aio, bool _adaptive);
+void aioGetCounters(const AIO *_aio, AIOCounters *_counters);
+
+// Descriptor cache: persistent files stay open for the AIO lifetime, the others are handed over
+// to the first command using them and closed once it completes. Preallocated files are written without truncation
+bool aioOpenFile(AIO *_aio, const char *_file, AIOFileMode _mode, bool _persistent, bool _truncate = true);
+
+// Asks the kernel to start reading a file range into the page cache ahead of its command, through a short-lived
+// descriptor that leaves the descriptor cache alone. Direct I/O files bypass the page cache and are left alone
+bool aioAdvise(AIO *_aio, const char *_file, size_t _size, size_t _offset = 0);
+
 typedef void (*aioEntryCallback)(const char *_name, bool _directory, size_t _size, void *_data);
 bool aioScanDirectory(const char *_dir, aioEntryCallback _callback, void *_data);
 
+// Streaming directory scan, entries are reported by batches with their path relative to the scanned directory.
+// The pattern (fnmatch) filters file names, sizes are only queried when asked for
+struct AIOScan;
+AIOScan *aioBeginScan(const char *_dir, const char *_pattern, bool _recursive, bool _sizes);
+int aioContinueScan(AIOScan *_scan, aioEntryCallback _callback, void *_data, int _max);
+void aioEndScan(AIOScan *_scan);
+
+// Ending a command buffer merges its reads of back to back ranges of one file into vectored commands
 AIOCmdBuffer *aioAllocCmdBuffer(AIO *_aio);
 void aioFreeCmdBuffer(AIOCmdBuffer *_cmdBuffer);
 void aioBeginCmdBuffer(AIOCmdBuffer *_cmdBuffer);
@@ -18,6 +70,17 @@ void aioEndCmdBuffer(AIOCmdBuffer *_cmdBuffer);
 bool aioCmdRead(AIOCmdBuffer *_cmdBuffer, void *_buffer, const char *_file, size_t _size, size_t _offset = 0);
 bool aioCmdWrite(AIOCmdBuffer *_cmdBuffer, void *_buffer, const char *_file, size_t _size, size_t _offset = 0);
 
+// Several command buffers can be in flight, each one completes on its own
 bool aioSubmitCmdBuffer(AIO *_aio, AIOCmdBuffer *_cmdBuffer);
+bool aioWaitCmdBuffer(AIO *_aio, AIOCmdBuffer *_cmdBuffer);
+bool aioPollCmdBuffer(AIO *_aio, AIOCmdBuffer *_cmdBuffer);
 bool aioWaitIdle(AIO *_aio);
+// Waits for every command and makes all the written data durable
+bool aioFlush(AIO *_aio);
+
+// Outcome of each aioCmdRead / aioCmdWrite in recording order, valid once the command buffer completed.
+// Partial transfers are resubmitted until done, a short count left means end of file or an error
+struct AIOResult { size_t requested; size_t bytes; int error; double latency; };
+int aioGetResultCount(const AIOCmdBuffer *_cmdBuffer);
+const AIOResult *aioGetResult(const AIOCmdBuffer *_cmdBuffer, int _index);
 
@@ -1,87 +1,689 @@
 #include "aio.h"
+#include "aio_uring.h"
+#include "aio_pool.h"
+#include "clock.h"
+#include <stdio.h>
+#include <string.h>
 #include <malloc.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <dirent.h>
+#include <fnmatch.h>
+#include <limits.h>
+#include <stdint.h>
+#include <pthread.h>
 #include <libaio.h>
 #include <sys/stat.h>
+#include <sys/sysmacros.h>
+#include <sys/syscall.h>
+
+struct AIOCommand
+{
+	uint64_t offset;
+	size_t size;
+	size_t progress;
+	int transfer;
+	int members;
+	int retries;
+	size_t alignment;
+	int tailFd;
+	bool writeBehind;
+};
+
+struct AIOTransfer
+{
+	AIOResult result;
+	int parts;
+};
 
 struct AIOCmdBuffer
 {
 	iocb **commands;
 	iocb *pool;
+	AIOCommand *states;
+	AIOTransfer *transfers;
+	iovec *vectors;
+	int *closing;
+	AIO *aio;
+	Clock submitted;
 	int count;
+	int transferCount;
+	int closeCount;
+	int remaining;
+	bool pending;
+	bool failed;
+};
+
+struct AIOFile
+{
+	char *path;
+	int fd;
+	int tailFd;
+	size_t alignment;
+	AIOFileMode mode;
+	bool persistent;
+};
+
+struct AIOWriteback
+{
+	uint64_t offset;
+	size_t size;
+	int fd;
+	bool close;
 };
 
+const int AIO_MAX_BUFFERS = 16;
+const int AIO_MAX_FILES = 256;
+const int AIO_MAX_PENDING = 32;
+const int AIO_MAX_RETRIES = 8;
+const int AIO_SCAN_DEPTH = 32;
+const int AIO_SCAN_BUFFER = 32768;
+const int AIO_SCAN_ENTRIES = 1024;
+const int AIO_MAX_WRITEBACK = 1024;
+const int AIO_MAX_DEVICES = 8;
+const int AIO_POOL_THREADS = 16;
+const int AIO_MAX_VECTOR = 64;
+const int AIO_MAX_STRIPES = 16;
+const size_t AIO_MIN_DEPTH = 4;
+const size_t AIO_INITIAL_DEPTH = 32;
+const int AIO_DEPTH_WINDOW = 64;
+const double AIO_DEPTH_GAIN = 1.05;
+const double AIO_DEPTH_KNEE = 2.0;
+const double AIO_DEPTH_DECAY = 0.95;
+const double AIO_BASELINE_DRIFT = 1.005;
+
 struct AIO
 {
 	io_context_t context;
+	AIOUring *uring;
+	AIOPool *pool;
 	io_event *events;
-	AIOCmdBuffer *pending;
+	AIOCmdBuffer *pending[AIO_MAX_PENDING];
+	int pendingCount;
+	int inflight;
+	iovec buffers[AIO_MAX_BUFFERS];
+	AIOFile files[AIO_MAX_FILES];
+	AIOWriteback writeback[AIO_MAX_WRITEBACK];
+	pthread_t writebackThread;
+	pthread_mutex_t writebackMutex;
+	pthread_cond_t writebackReady;
+	pthread_cond_t writebackDone;
+	int syncFds[AIO_MAX_DEVICES];
+	dev_t syncDevices[AIO_MAX_DEVICES];
+	int bufferCount;
+	int fileCount;
+	int writebackHead;
+	int writebackCount;
+	int writebackFlush;
+	int syncCount;
 	size_t size;
+	size_t chunk;
+	size_t pageSize;
+	size_t dirty;
+	size_t dirtyBudget;
+	AIOCounters counters;
+	Clock windowStart;
+	double windowLatency;
+	size_t windowBytes;
+	int windowCount;
+	double bestThroughput;
+	AIOBackend backend;
+	bool direct;
+	bool adaptive;
+	bool writebackStarted;
+	bool writebackExit;
 };
 
-AIO *aioCreate(size_t _size)
+AIO *aioCreate(size_t _size, AIOBackend _backend)
 {
 	AIO *aio = (AIO*) malloc(sizeof(AIO));
 
 	aio->size = _size;
-	aio->pending = 0;
+	aio->pendingCount = 0;
+	aio->inflight = 0;
+	aio->uring = 0;
+	aio->pool = 0;
+	aio->bufferCount = 0;
+	aio->fileCount = 0;
+	aio->backend = _backend;
+	aio->direct = false;
+	aio->chunk = AIO_DEFAULT_CHUNK;
+	aio->pageSize = (size_t) sysconf(_SC_PAGESIZE);
+	aio->writebackHead = 0;
+	aio->writebackCount = 0;
+	aio->writebackFlush = 0;
+	aio->writebackStarted = false;
+	aio->writebackExit = false;
+	pthread_mutex_init(&aio->writebackMutex, 0);
+	pthread_cond_init(&aio->writebackReady, 0);
+	pthread_cond_init(&aio->writebackDone, 0);
+	aio->syncCount = 0;
+	aio->dirty = 0;
+	aio->dirtyBudget = AIO_DEFAULT_WRITE_BEHIND;
+	aio->adaptive = true;
+	memset(&aio->counters, 0, sizeof(AIOCounters));
+	aio->counters.depth = (_size < AIO_INITIAL_DEPTH) ? _size : AIO_INITIAL_DEPTH;
+	aio->counters.peakDepth = aio->counters.depth;
+	aio->windowLatency = 0.0;
+	aio->windowBytes = 0;
+	aio->windowCount = 0;
+	aio->bestThroughput = 0.0;
+	clockGetTime(&aio->windowStart);
 	aio->events = (io_event*) malloc(sizeof(io_event) * _size);
 	memset(&aio->context, 0, sizeof(io_context_t));
-	long result = io_setup(aio->size, &aio->context);
+
+	if(aio->backend == AIOBackend_Uring)
+	{
+		aio->uring = uringCreate(aio->size);
+		if(aio->uring == 0)
+		{
+			printf("[Warning] AIO io_uring is not available, falling back to libaio\n");
+			aio->backend = AIOBackend_Libaio;
+		}
+	}
+
+	if(aio->backend == AIOBackend_Pool)
+	{
+		aio->pool = poolCreate(aio->size, AIO_POOL_THREADS);
+		if(aio->pool == 0)
+		{
+			printf("[Warning] AIO worker pool could not be started, falling back to libaio\n");
+			aio->backend = AIOBackend_Libaio;
+		}
+	}
+
+	if(aio->backend == AIOBackend_Libaio)
+	{
+		long result = io_setup(aio->size, &aio->context);
+	}
 
 	return aio;
 }
 
+static bool aioWritebackDue(const AIO *_aio)
+{
+	return _aio->writebackCount > 0 && (_aio->dirty > _aio->dirtyBudget || _aio->writebackFlush > 0);
+}
+
+static void *aioWritebackWorker(void *_data)
+{
+	AIO *aio = (AIO *) _data;
+
+	pthread_mutex_lock(&aio->writebackMutex);
+	for(;;)
+	{
+		while(!aioWritebackDue(aio) && !aio->writebackExit) pthread_cond_wait(&aio->writebackReady, &aio->writebackMutex);
+		if(!aioWritebackDue(aio)) break;
+
+		// Wait for the oldest range to reach the disk, its pages are clean and can leave the cache.
+		// The range stays queued meanwhile so its descriptor can still be handed over
+		AIOWriteback range = aio->writeback[aio->writebackHead];
+		pthread_mutex_unlock(&aio->writebackMutex);
+		sync_file_range(range.fd, range.offset, range.size, 
+			SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+		posix_fadvise(range.fd, range.offset, range.size, POSIX_FADV_DONTNEED);
+		pthread_mutex_lock(&aio->writebackMutex);
+
+		if(aio->writeback[aio->writebackHead].close) close(range.fd);
+		aio->dirty -= range.size;
+		aio->writebackHead = (aio->writebackHead + 1) % AIO_MAX_WRITEBACK;
+		--aio->writebackCount;
+		pthread_cond_broadcast(&aio->writebackDone);
+	}
+	pthread_mutex_unlock(&aio->writebackMutex);
+
+	return 0;
+}
+
+static void aioWriteBehind(AIO *_aio, int _fd, uint64_t _offset, size_t _size)
+{
+	if(_aio->dirtyBudget == 0) return;
+
+	// Only start the writeback here, the worker waits for it once more than the budget is dirty
+	sync_file_range(_fd, _offset, _size, SYNC_FILE_RANGE_WRITE);
+	if(!_aio->writebackStarted) _aio->writebackStarted = pthread_create(&_aio->writebackThread, 0, aioWritebackWorker, _aio) == 0;
+	if(!_aio->writebackStarted) return;
+
+	// A full queue leaves the range to the kernel flusher rather than blocking the executor
+	pthread_mutex_lock(&_aio->writebackMutex);
+	if(_aio->writebackCount < AIO_MAX_WRITEBACK)
+	{
+		AIOWriteback *range = _aio->writeback + (_aio->writebackHead + _aio->writebackCount) % AIO_MAX_WRITEBACK;
+		range->offset = _offset;
+		range->size = _size;
+		range->fd = _fd;
+		range->close = false;
+		++_aio->writebackCount;
+		_aio->dirty += _size;
+		if(_aio->dirty > _aio->dirtyBudget) pthread_cond_signal(&_aio->writebackReady);
+	}
+	pthread_mutex_unlock(&_aio->writebackMutex);
+}
+
+static void aioWaitWriteback(AIO *_aio)
+{
+	pthread_mutex_lock(&_aio->writebackMutex);
+	++_aio->writebackFlush;
+	pthread_cond_signal(&_aio->writebackReady);
+	while(_aio->writebackCount > 0) pthread_cond_wait(&_aio->writebackDone, &_aio->writebackMutex);
+	--_aio->writebackFlush;
+	pthread_mutex_unlock(&_aio->writebackMutex);
+}
+
+static void aioCloseDescriptor(AIO *_aio, int _fd)
+{
+	// Descriptors of queued ranges are closed by the worker after the newest one, the file keeps a single descriptor
+	bool queued = false;
+	pthread_mutex_lock(&_aio->writebackMutex);
+	for(int i = _aio->writebackCount - 1; i >= 0 && !queued; --i)
+	{
+		AIOWriteback *range = _aio->writeback + (_aio->writebackHead + i) % AIO_MAX_WRITEBACK;
+		queued = range->fd == _fd;
+		if(queued) range->close = true;
+	}
+	pthread_mutex_unlock(&_aio->writebackMutex);
+
+	if(!queued) close(_fd);
+}
+
+static void aioTrackDevice(AIO *_aio, int _fd)
+{
+	// One descriptor per written filesystem is enough to sync it at the end
+	struct stat st;
+	if(fstat(_fd, &st) != 0) return;
+
+	for(int i = 0; i < _aio->syncCount; ++i)
+		if(_aio->syncDevices[i] == st.st_dev) return;
+
+	if(_aio->syncCount < AIO_MAX_DEVICES)
+	{
+		int fd = fcntl(_fd, F_DUPFD_CLOEXEC, 0);
+		if(fd < 0) return;
+		_aio->syncFds[_aio->syncCount] = fd;
+		_aio->syncDevices[_aio->syncCount] = st.st_dev;
+		++_aio->syncCount;
+	}
+}
+
 void aioDestroy(AIO *_aio)
 {
 	aioWaitIdle(_aio);
+	aioWaitWriteback(_aio);
+	if(_aio->writebackStarted)
+	{
+		pthread_mutex_lock(&_aio->writebackMutex);
+		_aio->writebackExit = true;
+		pthread_cond_signal(&_aio->writebackReady);
+		pthread_mutex_unlock(&_aio->writebackMutex);
+		pthread_join(_aio->writebackThread, 0);
+	}
+	pthread_mutex_destroy(&_aio->writebackMutex);
+	pthread_cond_destroy(&_aio->writebackReady);
+	pthread_cond_destroy(&_aio->writebackDone);
+	for(int i = 0; i < _aio->syncCount; ++i) close(_aio->syncFds[i]);
 	free(_aio->events);
-	io_destroy(_aio->context);
+
+	if(_aio->uring) uringDestroy(_aio->uring);
+	else if(_aio->pool) poolDestroy(_aio->pool);
+	else io_destroy(_aio->context);
+
+	for(int i = 0; i < _aio->fileCount; ++i)
+	{
+		close(_aio->files[i].fd);
+		if(_aio->files[i].tailFd >= 0) close(_aio->files[i].tailFd);
+		free(_aio->files[i].path);
+	}
 
 	free(_aio);
 }
 
-bool aioScanDirectory(const char *_dir, aioEntryCallback _callback, void *_data)
+bool aioRegisterBuffer(AIO *_aio, void *_buffer, size_t _size)
 {
 	bool ret = false;
 
-	DIR *dir = opendir(_dir);
-	if(dir != 0)
+	if(_aio->bufferCount < AIO_MAX_BUFFERS)
 	{
-		dirent *entry = readdir(dir);
-		while(entry != 0)
+		_aio->buffers[_aio->bufferCount].iov_base = _buffer;
+		_aio->buffers[_aio->bufferCount].iov_len = _size;
+		++_aio->bufferCount;
+
+		// libaio has no notion of registered buffers, only io_uring pins them
+		ret = true;
+		if(_aio->uring)
 		{
-			if(entry->d_type == DT_DIR)
-			{
-				_callback(entry->d_name, true, 0, _data);
-			}
-			else if(entry->d_type == DT_REG)
-			{
-				struct stat st;
-				char path[512];
-				strcpy(path, _dir); strcat(path, "/"); strcat(path, entry->d_name);
+			ret = uringRegisterBuffers(_aio->uring, _aio->buffers, _aio->bufferCount);
+			if(!ret) printf("[Warning] AIO io_uring buffer registration failed, using unregistered transfers\n");
+		}
+	}
+
+	return ret;
+}
+
+void aioSetDirect(AIO *_aio, bool _direct)
+{
+	_aio->direct = _direct;
+}
+
+void aioSetChunkSize(AIO *_aio, size_t _chunk)
+{
+	_aio->chunk = _chunk;
+}
+
+void aioSetWriteBehind(AIO *_aio, size_t _budget)
+{
+	_aio->dirtyBudget = _budget;
+}
+
+void aioSetAdaptiveDepth(AIO *_aio, bool _adaptive)
+{
+	_aio->adaptive = _adaptive;
+	_aio->counters.depth = (_adaptive && _aio->size > AIO_INITIAL_DEPTH) ? AIO_INITIAL_DEPTH : _aio->size;
+	if(_aio->counters.depth > _aio->counters.peakDepth) _aio->counters.peakDepth = _aio->counters.depth;
+}
+
+void aioGetCounters(const AIO *_aio, AIOCounters *_counters)
+{
+	*_counters = _aio->counters;
+}
+
+static size_t aioLogicalBlockSize(int _fd)
+{
+	size_t size = 0;
+
+	// Prefer the alignment reported by the filesystem itself (Linux 6.1+)
+	struct statx stx;
+	if(statx(_fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 && (stx.stx_mask & STATX_DIOALIGN))
+	{
+		size = stx.stx_dio_offset_align;
+		if(stx.stx_dio_mem_align > size) size = stx.stx_dio_mem_align;
+		if(size > 0) return size;
+	}
+
+	// Otherwise ask the block device, partitions expose their queue on the parent device
+	struct stat st;
+	if(fstat(_fd, &st) != 0) return 0;
+
+	const char *formats[] = { "/sys/dev/block/%u:%u/queue/logical_block_size",
+							"/sys/dev/block/%u:%u/../queue/logical_block_size" };
+	for(int i = 0; i < 2 && size == 0; ++i)
+	{
+		char path[128];
+		sprintf(path, formats[i], major(st.st_dev), minor(st.st_dev));
+		FILE *fp = fopen(path, "r");
+		if(fp) { if(fscanf(fp, "%lu", &size) != 1) size = 0; fclose(fp); }
+	}
+
+	// Last resort, the preferred I/O size is always a multiple of the logical block size
+	return (size > 0) ? size : st.st_blksize;
+}
+
+static int aioOpen(AIO *_aio, const char *_file, AIOFileMode _mode, bool _truncate, size_t *_alignment)
+{
+	int flags = (_mode == AIOFileMode_Read) ? O_NONBLOCK | O_RDONLY : O_NONBLOCK | O_WRONLY | O_CREAT;
+	if(_mode == AIOFileMode_Write && _truncate) flags |= O_TRUNC;
+	*_alignment = 0;
+
+	int fd = -1;
+	if(_aio->direct)
+	{
+		fd = open(_file, flags | O_DIRECT, 0644);
+		if(fd >= 0) *_alignment = aioLogicalBlockSize(fd);
+		// Some filesystems (tmpfs, FUSE) refuse O_DIRECT, this file goes through the page cache
+	}
+
+	if(fd < 0) fd = open(_file, flags, 0644);
+	if(fd >= 0 && _mode == AIOFileMode_Write) aioTrackDevice(_aio, fd);
+
+	return fd;
+}
+
+static int aioOpenTail(const AIOFile *_file)
+{
+	// Buffered descriptor for the part of a transfer that is not block aligned, never truncates
+	if(_file->mode == AIOFileMode_Read) return open(_file->path, O_NONBLOCK | O_RDONLY);
+	else return open(_file->path, O_NONBLOCK | O_WRONLY);
+}
+
+static int aioFindFile(const AIO *_aio, const char *_file, AIOFileMode _mode)
+{
+	for(int i = 0; i < _aio->fileCount; ++i)
+	{
+		const AIOFile *entry = _aio->files + i;
+		if(entry->mode == _mode && strcmp(entry->path, _file) == 0) return i;
+	}
+
+	return -1;
+}
+
+static AIOFile *aioAcquireFile(AIO *_aio, const char *_file, AIOFileMode _mode, AIOFile *_transient)
+{
+	int index = aioFindFile(_aio, _file, _mode);
+	if(index >= 0 && _aio->files[index].persistent) return _aio->files + index;
+
+	// Transient descriptors now belong to the command, drop them from the cache
+	if(index >= 0)
+	{
+		*_transient = _aio->files[index];
+		_aio->files[index] = _aio->files[_aio->fileCount - 1];
+		--_aio->fileCount;
+	}
+	else
+	{
+		_transient->path = strdup(_file);
+		_transient->fd = aioOpen(_aio, _file, _mode, true, &_transient->alignment);
+		_transient->tailFd = -1;
+		_transient->mode = _mode;
+		_transient->persistent = false;
+	}
+
+	return _transient;
+}
+
+bool aioOpenFile(AIO *_aio, const char *_file, AIOFileMode _mode, bool _persistent, bool _truncate)
+{
+	bool ret = aioFindFile(_aio, _file, _mode) >= 0;
+
+	if(!ret && _aio->fileCount < AIO_MAX_FILES)
+	{
+		size_t alignment = 0;
+		int fd = aioOpen(_aio, _file, _mode, _truncate, &alignment);
+		if(fd >= 0)
+		{
+			AIOFile *entry = _aio->files + _aio->fileCount;
+			entry->path = strdup(_file);
+			entry->fd = fd;
+			entry->tailFd = -1;
+			entry->alignment = alignment;
+			entry->mode = _mode;
+			entry->persistent = _persistent;
+			++_aio->fileCount;
+			ret = true;
+		}
+	}
+
+	return ret;
+}
+
+bool aioAdvise(AIO *_aio, const char *_file, size_t _size, size_t _offset)
+{
+	// Direct I/O files bypass the page cache, the same probe as aioOpen tells which ones will
+	int index = aioFindFile(_aio, _file, AIOFileMode_Read);
+	if(index >= 0) return _aio->files[index].alignment == 0 && posix_fadvise(_aio->files[index].fd, _offset, _size, POSIX_FADV_WILLNEED) == 0;
+
+	int fd = _aio->direct ? open(_file, O_RDONLY | O_DIRECT | O_CLOEXEC) : -1;
+	if(fd >= 0) { close(fd); return false; }
+
+	// A short-lived descriptor, the readahead belongs to the file and outlives it. The cache is kept for transfers
+	fd = open(_file, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) return false;
+	bool ret = posix_fadvise(fd, _offset, _size, POSIX_FADV_WILLNEED) == 0;
+	close(fd);
+
+	return ret;
+}
+
+struct AIODirent
+{
+	uint64_t ino;
+	int64_t off;
+	unsigned short reclen;
+	unsigned char type;
+	char name[1];
+};
+
+struct AIOScanLevel
+{
+	char *buffer;
+	int fd;
+	int position;
+	int length;
+	size_t pathLength;
+};
+
+struct AIOScan
+{
+	AIOScanLevel levels[AIO_SCAN_DEPTH];
+	char path[PATH_MAX];
+	char *pattern;
+	int depth;
+	bool recursive;
+	bool sizes;
+};
+
+static bool aioPushScan(AIOScan *_scan, int _fd, size_t _pathLength)
+{
+	if(_fd < 0) return false;
+	if(_scan->depth >= AIO_SCAN_DEPTH) { close(_fd); return false; }
+
+	AIOScanLevel *level = _scan->levels + _scan->depth++;
+	level->buffer = (char *) malloc(AIO_SCAN_BUFFER);
+	level->fd = _fd;
+	level->position = 0;
+	level->length = 0;
+	level->pathLength = _pathLength;
+
+	return true;
+}
+
+static void aioPopScan(AIOScan *_scan)
+{
+	AIOScanLevel *level = _scan->levels + --_scan->depth;
+	close(level->fd);
+	free(level->buffer);
+}
+
+AIOScan *aioBeginScan(const char *_dir, const char *_pattern, bool _recursive, bool _sizes)
+{
+	AIOScan *scan = (AIOScan *) malloc(sizeof(AIOScan));
+	scan->path[0] = 0;
+	scan->pattern = (_pattern != 0) ? strdup(_pattern) : 0;
+	scan->depth = 0;
+	scan->recursive = _recursive;
+	scan->sizes = _sizes;
+
+	if(!aioPushScan(scan, open(_dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC), 0))
+	{
+		aioEndScan(scan);
+		scan = 0;
+	}
+
+	return scan;
+}
+
+int aioContinueScan(AIOScan *_scan, aioEntryCallback _callback, void *_data, int _max)
+{
+	int reported = 0;
+
+	while(reported < _max && _scan->depth > 0)
+	{
+		AIOScanLevel *level = _scan->levels + _scan->depth - 1;
+		if(level->position >= level->length)
+		{
+			// Refill with a whole batch of entries at once, an exhausted directory goes back to its parent
+			level->length = (int) syscall(SYS_getdents64, level->fd, level->buffer, AIO_SCAN_BUFFER);
+			level->position = 0;
+			if(level->length <= 0) { aioPopScan(_scan); continue; }
+		}
+
+		const AIODirent *entry = (const AIODirent *) (level->buffer + level->position);
+		level->position += entry->reclen;
+
+		const char *name = entry->name;
+		if(name[0] == '.' && (name[1] == 0 || (name[1] == '.' && name[2] == 0))) continue;
+
+		size_t length = strlen(name);
+		if(level->pathLength + length + 2 > PATH_MAX) continue;
+
+		// Filesystems without d_type need a statx, relative to the directory so the kernel skips the path walk
+		unsigned char type = entry->type;
+		struct statx stx;
+		bool stated = false;
+		if(type == DT_UNKNOWN || (type == DT_REG && _scan->sizes))
+		{
+			stated = statx(level->fd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, STATX_TYPE | STATX_SIZE, &stx) == 0;
+			if(stated && type == DT_UNKNOWN) type = S_ISDIR(stx.stx_mode) ? DT_DIR : S_ISREG(stx.stx_mode) ? DT_REG : DT_UNKNOWN;
+		}
 
-				lstat(path, &st);
-				_callback(entry->d_name, false, st.st_size, _data);
+		memcpy(_scan->path + level->pathLength, name, length + 1);
+
+		if(type == DT_DIR)
+		{
+			_callback(_scan->path, true, 0, _data);
+
+			if(_scan->recursive)
+			{
+				_scan->path[level->pathLength + length] = '/';
+				aioPushScan(_scan, openat(level->fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC), level->pathLength + length + 1);
 			}
-			entry = readdir(dir);
 		}
+		else if(type == DT_REG)
+		{
+			if(_scan->pattern && fnmatch(_scan->pattern, name, 0) != 0) continue;
 
-		closedir(dir);
-		ret = true;
+			_callback(_scan->path, false, stated ? stx.stx_size : 0, _data);
+			++reported;
+		}
 	}
-	
-	return ret;
+
+	return reported;
+}
+
+void aioEndScan(AIOScan *_scan)
+{
+	while(_scan->depth > 0) aioPopScan(_scan);
+	free(_scan->pattern);
+	free(_scan);
+}
+
+bool aioScanDirectory(const char *_dir, aioEntryCallback _callback, void *_data)
+{
+	AIOScan *scan = aioBeginScan(_dir, 0, false, true);
+	if(scan == 0) return false;
+
+	// Files are reported by batches of entries until the scan runs out
+	while(aioContinueScan(scan, _callback, _data, AIO_SCAN_ENTRIES) > 0) {}
+	aioEndScan(scan);
+
+	return true;
 }
 
 AIOCmdBuffer *aioAllocCmdBuffer(AIO *_aio)
 {
-	AIOCmdBuffer *cmd = (AIOCmdBuffer *)malloc(sizeof(AIO));
+	AIOCmdBuffer *cmd = (AIOCmdBuffer *)malloc(sizeof(AIOCmdBuffer));
 	cmd->pool = (iocb *) malloc(sizeof(iocb) * _aio->size);
 	cmd->commands = (iocb **) malloc(sizeof(iocb*) * _aio->size);
+	cmd->states = (AIOCommand *) malloc(sizeof(AIOCommand) * _aio->size);
+	cmd->transfers = (AIOTransfer *) malloc(sizeof(AIOTransfer) * _aio->size);
+	cmd->vectors = (iovec *) malloc(sizeof(iovec) * _aio->size);
+	cmd->closing = (int *) malloc(sizeof(int) * 2 * _aio->size);
+	cmd->aio = _aio;
 	cmd->count = 0;
+	cmd->transferCount = 0;
+	cmd->closeCount = 0;
+	cmd->remaining = 0;
+	cmd->pending = false;
+	cmd->failed = false;
 
 	for(int i = 0; i < _aio->size; ++i) cmd->commands[i] = cmd->pool + i;
 
@@ -92,87 +694,512 @@ void aioFreeCmdBuffer(AIOCmdBuffer *_cmdBuffer)
 {
 	free(_cmdBuffer->commands);
 	free(_cmdBuffer->pool);
+	free(_cmdBuffer->states);
+	free(_cmdBuffer->transfers);
+	free(_cmdBuffer->vectors);
+	free(_cmdBuffer->closing);
 	free(_cmdBuffer);
 }
 
 void aioBeginCmdBuffer(AIOCmdBuffer *_cmdBuffer)
 {
+	// Merging left the command list compacted, record in pool order again
+	for(int i = 0; i < (int) _cmdBuffer->aio->size; ++i) _cmdBuffer->commands[i] = _cmdBuffer->pool + i;
 	_cmdBuffer->count = 0;
+	_cmdBuffer->transferCount = 0;
+	_cmdBuffer->closeCount = 0;
 }
 
 void aioEndCmdBuffer(AIOCmdBuffer *_cmdBuffer)
 {
+	// Reads of back to back ranges of the same file become a single vectored command, as long as they fit in a chunk.
+	// Striped chunks are already full sized and stay apart
+	size_t chunk = _cmdBuffer->aio->chunk;
+	int count = 0;
+	for(int i = 0; i < _cmdBuffer->count; i += _cmdBuffer->states[i].members)
+	{
+		iocb *leader = _cmdBuffer->pool + i;
+		AIOCommand *state = _cmdBuffer->states + i;
+		size_t size = state->size;
+
+		while(leader->aio_lio_opcode == IO_CMD_PREAD && i + state->members < _cmdBuffer->count && state->members < AIO_MAX_VECTOR)
+		{
+			const iocb *next = leader + state->members;
+			const AIOCommand *member = state + state->members;
+			bool contiguous = next->aio_lio_opcode == IO_CMD_PREAD && next->aio_fildes == leader->aio_fildes && member->offset == state->offset + size;
+			if(!contiguous || (chunk > 0 && size + member->size > chunk)) break;
+
+			size += member->size;
+			++state->members;
+		}
+
+		if(state->members > 1)
+		{
+			iovec *vectors = _cmdBuffer->vectors + i;
+			for(int j = 0; j < state->members; ++j)
+			{
+				vectors[j].iov_base = leader[j].u.c.buf;
+				vectors[j].iov_len = state[j].size;
+			}
+			io_prep_preadv(leader, leader->aio_fildes, vectors, state->members, state->offset);
+		}
+
+		_cmdBuffer->commands[count++] = leader;
+	}
+
+	_cmdBuffer->count = count;
+}
+
+static bool aioRecord(AIOCmdBuffer *_cmdBuffer, AIOFileMode _mode, int _fd, void *_buffer, size_t _size, size_t _offset)
+{
+	if(_cmdBuffer->count >= (int) _cmdBuffer->aio->size) return false;
+
+	iocb *command = _cmdBuffer->commands[_cmdBuffer->count];
+	if(_mode == AIOFileMode_Read) io_prep_pread(command, _fd, _buffer, _size, _offset);
+	else io_prep_pwrite(command, _fd, _buffer, _size, _offset);
 
+	// Every command contributes to the result of the transfer being recorded
+	AIOCommand *state = _cmdBuffer->states + _cmdBuffer->count;
+	state->offset = _offset;
+	state->size = _size;
+	state->progress = 0;
+	state->transfer = _cmdBuffer->transferCount - 1;
+	state->members = 1;
+	state->retries = 0;
+	state->alignment = 0;
+	state->tailFd = -1;
+	state->writeBehind = false;
+	++_cmdBuffer->transfers[state->transfer].parts;
+	++_cmdBuffer->count;
+
+	return true;
 }
 
-bool aioCmdRead(AIOCmdBuffer *_cmdBuffer, void *_buffer, const char *_file, size_t _size, size_t _offset)
+static bool aioRecordStriped(AIOCmdBuffer *_cmdBuffer, AIOFileMode _mode, const AIOFile *_file, void *_buffer, size_t _size, size_t _offset, bool _tail)
 {
-	bool ret = false;
+	size_t chunk = _cmdBuffer->aio->chunk;
+	if(chunk == 0 || _size < 2 * chunk) return aioRecord(_cmdBuffer, _mode, _file->fd, _buffer, _size, _offset);
 
-	int fd = open(_file, O_NONBLOCK | O_RDONLY /*| O_DIRECT*/);
-	if(fd > 0)
+	// One transfer takes at most half of the commands left, keeping one for the tail, so the next ones still fit.
+	// Chunks grow to stay within that share, without two stripes the transfer is a single command
+	int available = (int) _cmdBuffer->aio->size - _cmdBuffer->count - (_tail ? 1 : 0);
+	if(available < 1) return false;
+	size_t stripes = (_size + chunk - 1) / chunk;
+	if(stripes > (size_t) AIO_MAX_STRIPES) stripes = AIO_MAX_STRIPES;
+	if(stripes > (size_t) available / 2) stripes = available / 2;
+	if(stripes < 2) return aioRecord(_cmdBuffer, _mode, _file->fd, _buffer, _size, _offset);
+	if(stripes * chunk < _size) chunk = (_size + stripes - 1) / stripes;
+
+	// Direct I/O chunks must stay block aligned
+	if(_file->alignment > 0) chunk = (chunk + _file->alignment - 1) & ~(_file->alignment - 1);
+
+	bool ret = true;
+	for(size_t done = 0; ret && done < _size; done += chunk)
 	{
-		io_prep_pread(_cmdBuffer->commands[_cmdBuffer->count], fd, _buffer, _size, _offset);
-		++_cmdBuffer->count;
-		ret = true;
+		size_t size = (_size - done < chunk) ? _size - done : chunk;
+		ret = aioRecord(_cmdBuffer, _mode, _file->fd, (char *) _buffer + done, size, _offset + done);
 	}
 
 	return ret;
 }
 
-bool aioCmdWrite(AIOCmdBuffer *_cmdBuffer, void *_buffer, const char *_file, size_t _size, size_t _offset)
+static bool aioCmdTransfer(AIOCmdBuffer *_cmdBuffer, AIOFileMode _mode, void *_buffer, const char *_file, size_t _size, size_t _offset)
 {
-	bool ret = false;
+	if(_cmdBuffer->transferCount >= (int) _cmdBuffer->aio->size) return false;
+
+	AIOTransfer *transfer = _cmdBuffer->transfers + _cmdBuffer->transferCount++;
+	memset(transfer, 0, sizeof(AIOTransfer));
+	transfer->result.requested = _size;
+
+	AIOFile transient;
+	AIOFile *file = aioAcquireFile(_cmdBuffer->aio, _file, _mode, &transient);
+	int count = _cmdBuffer->count;
+	bool ret = file->fd >= 0;
+	if(!ret) transfer->result.error = errno;
 
-	int fd = open(_file, O_NONBLOCK | O_WRONLY | O_CREAT | O_TRUNC /*| O_DIRECT*/, 0644);
-	if(fd > 0)
+	if(ret)
 	{
-		io_prep_pwrite(_cmdBuffer->commands[_cmdBuffer->count], fd, _buffer, _size, _offset);
-		++_cmdBuffer->count;
-		ret = true;
+		// Direct I/O only covers the block aligned head of the transfer, the tail goes through the page cache.
+		// The head ends on a page boundary so no cached page of the tail overlaps bytes written directly
+		size_t head = _size;
+		if(file->alignment > 0)
+		{
+			size_t granule = (file->alignment > _cmdBuffer->aio->pageSize) ? file->alignment : _cmdBuffer->aio->pageSize;
+			size_t end = (_offset + _size) & ~(granule - 1);
+			bool aligned = ((size_t) _buffer % file->alignment) == 0 && (_offset % file->alignment) == 0;
+			head = (aligned && end > _offset) ? end - _offset : 0;
+		}
+
+		if(head < _size && file->tailFd < 0) file->tailFd = aioOpenTail(file);
+
+		if(head > 0) ret = aioRecordStriped(_cmdBuffer, _mode, file, _buffer, head, _offset, head < _size);
+		if(ret && head < _size)
+		{
+			ret = (file->tailFd >= 0) &&
+				aioRecord(_cmdBuffer, _mode, file->tailFd, (char *) _buffer + head, _size - head, _offset + head);
+		}
+
+		if(!ret) transfer->result.error = (file->tailFd >= 0 || head == _size) ? ENOBUFS : EBADF;
+
+		// Only writes through the page cache leave dirty pages behind
+		for(int i = count; _mode == AIOFileMode_Write && i < _cmdBuffer->count; ++i)
+			_cmdBuffer->states[i].writeBehind = _cmdBuffer->commands[i]->aio_fildes != file->fd || file->alignment == 0;
+
+		// Direct commands remember where a short transfer can go on when its remainder is no longer aligned
+		for(int i = count; file->alignment > 0 && i < _cmdBuffer->count; ++i)
+		{
+			if(_cmdBuffer->commands[i]->aio_fildes != file->fd) continue;
+			_cmdBuffer->states[i].alignment = file->alignment;
+			_cmdBuffer->states[i].tailFd = file->tailFd;
+		}
+	}
+
+	// Close the command descriptors once it completes, cached ones stay open
+	if(!file->persistent)
+	{
+		int fds[2] = { file->fd, file->tailFd };
+		for(int i = 0; i < 2; ++i)
+		{
+			if(fds[i] < 0) continue;
+			if(_cmdBuffer->count > count) _cmdBuffer->closing[_cmdBuffer->closeCount++] = fds[i];
+			else close(fds[i]);
+		}
+		free(file->path);
 	}
 
 	return ret;
 }
 
+bool aioCmdRead(AIOCmdBuffer *_cmdBuffer, void *_buffer, const char *_file, size_t _size, size_t _offset)
+{
+	return aioCmdTransfer(_cmdBuffer, AIOFileMode_Read, _buffer, _file, _size, _offset);
+}
+
+bool aioCmdWrite(AIOCmdBuffer *_cmdBuffer, void *_buffer, const char *_file, size_t _size, size_t _offset)
+{
+	return aioCmdTransfer(_cmdBuffer, AIOFileMode_Write, _buffer, _file, _size, _offset);
+}
+
+static void aioRetire(AIO *_aio, AIOCmdBuffer *_cmdBuffer)
+{
+	// Close file descriptors owned by the commands, cached ones stay open
+	for(int i = 0; i < _cmdBuffer->closeCount; ++i) aioCloseDescriptor(_aio, _cmdBuffer->closing[i]);
+	_cmdBuffer->closeCount = 0;
+
+	for(int i = 0; i < _aio->pendingCount; ++i)
+	{
+		if(_aio->pending[i] != _cmdBuffer) continue;
+		_aio->pending[i] = _aio->pending[_aio->pendingCount - 1];
+		--_aio->pendingCount;
+		break;
+	}
+
+	_cmdBuffer->pending = false;
+}
+
+static int aioBackendSubmit(AIO *_aio, iocb **_commands, int _count)
+{
+	if(_aio->uring) return uringSubmit(_aio->uring, _commands, _count);
+	if(_aio->pool) return poolSubmit(_aio->pool, _commands, _count);
+	return io_submit(_aio->context, _count, _commands);
+}
+
+static bool aioResubmit(AIO *_aio, iocb *_command)
+{
+	return aioBackendSubmit(_aio, &_command, 1) == 1;
+}
+
+static void aioFailVector(AIOCmdBuffer *_cmdBuffer, const AIOCommand *_state, int _error)
+{
+	for(int j = 0; j < _state->members; ++j)
+	{
+		AIOResult *result = &_cmdBuffer->transfers[_state[j].transfer].result;
+		if(result->error == 0) result->error = _error;
+	}
+}
+
+// Direct I/O only takes block aligned remainders, the rest of a short transfer moves to the buffered descriptor.
+// Without one it can't go on, a short direct read has then reached the end of the file
+static bool aioRedirect(iocb *_command, AIOCommand *_state, const iovec *_vectors, int _count, uint64_t _offset)
+{
+	size_t alignment = _state->alignment;
+	if(alignment == 0 || _command->aio_fildes == _state->tailFd) return true;
+
+	// Every vector of the command has to be aligned, the whole command moves otherwise
+	bool aligned = _offset % alignment == 0;
+	for(int i = 0; aligned && i < _count; ++i)
+		aligned = (size_t) _vectors[i].iov_base % alignment == 0 && _vectors[i].iov_len % alignment == 0;
+	if(aligned) return true;
+	if(_state->tailFd < 0) return false;
+
+	_command->aio_fildes = _state->tailFd;
+	if(_command->aio_lio_opcode == IO_CMD_PWRITE) _state->writeBehind = true;
+	return true;
+}
+
+static bool aioContinueVector(AIO *_aio, AIOCmdBuffer *_cmdBuffer, iocb *_command, long _res)
+{
+	AIOCommand *state = _cmdBuffer->states + (_command - _cmdBuffer->pool);
+
+	if(_res > 0)
+	{
+		// Credit each member transfer with the part of the bytes that landed in its range
+		size_t begin = state->progress;
+		size_t end = begin + _res;
+		size_t start = 0;
+		for(int j = 0; j < state->members; ++j)
+		{
+			size_t low = (begin > start) ? begin : start;
+			size_t high = (end < start + state[j].size) ? end : start + state[j].size;
+			if(high > low) _cmdBuffer->transfers[state[j].transfer].result.bytes += high - low;
+			start += state[j].size;
+		}
+		state->progress = end;
+		if(end >= start) return false;
+
+		// Short transfer, drop the vectors already filled and trim the partial one
+		iovec *vector = (iovec *) _command->u.v.vec;
+		size_t skip = _res;
+		for(; skip >= vector->iov_len; ++vector, --_command->u.v.nr) skip -= vector->iov_len;
+		vector->iov_base = (char *) vector->iov_base + skip;
+		vector->iov_len -= skip;
+		_command->u.v.vec = vector;
+		_command->u.v.offset += _res;
+		state->retries = 0;
+		if(!aioRedirect(_command, state, vector, (int) _command->u.v.nr, _command->u.v.offset)) return false; // End of file
+	}
+	else if(_res == 0) return false; // End of file
+	else if((_res != -EAGAIN && _res != -EINTR) || ++state->retries > AIO_MAX_RETRIES)
+	{
+		aioFailVector(_cmdBuffer, state, (int) -_res);
+		return false;
+	}
+
+	if(aioResubmit(_aio, _command)) return true;
+
+	aioFailVector(_cmdBuffer, state, EIO);
+	return false;
+}
+
+static bool aioContinue(AIO *_aio, AIOCmdBuffer *_cmdBuffer, iocb *_command, long _res)
+{
+	AIOCommand *state = _cmdBuffer->states + (_command - _cmdBuffer->pool);
+	if(state->members > 1) return aioContinueVector(_aio, _cmdBuffer, _command, _res);
+
+	AIOResult *result = &_cmdBuffer->transfers[state->transfer].result;
+
+	if(_res > 0)
+	{
+		result->bytes += _res;
+		if((size_t) _res >= _command->u.c.nbytes) return false;
+
+		// Short transfer, move the command forward over what is already done
+		_command->u.c.buf = (char *) _command->u.c.buf + _res;
+		_command->u.c.nbytes -= _res;
+		_command->u.c.offset += _res;
+		state->retries = 0;
+		iovec remainder = { _command->u.c.buf, (size_t) _command->u.c.nbytes };
+		if(!aioRedirect(_command, state, &remainder, 1, _command->u.c.offset))
+		{
+			if(_command->aio_lio_opcode == IO_CMD_PWRITE) result->error = EIO;
+			return false; // End of file
+		}
+	}
+	else if(_res == 0) return false; // End of file
+	else if((_res != -EAGAIN && _res != -EINTR) || ++state->retries > AIO_MAX_RETRIES)
+	{
+		result->error = (int) -_res;
+		return false;
+	}
+
+	if(aioResubmit(_aio, _command)) return true;
+
+	result->error = EIO;
+	return false;
+}
+
+static void aioComplete(AIOCmdBuffer *_cmdBuffer, int _transfer, const Clock *_now)
+{
+	AIOTransfer *transfer = _cmdBuffer->transfers + _transfer;
+	if(--transfer->parts > 0) return;
+
+	transfer->result.latency = clockDeltaTime(&_cmdBuffer->submitted, _now);
+	if(transfer->result.error != 0 || transfer->result.bytes < transfer->result.requested) _cmdBuffer->failed = true;
+}
+
+static void aioAdaptDepth(AIO *_aio, const Clock *_now)
+{
+	AIOCounters *counters = &_aio->counters;
+	double elapsed = clockDeltaTime(&_aio->windowStart, _now);
+	int window = (2 * (int) counters->depth > AIO_DEPTH_WINDOW) ? 2 * (int) counters->depth : AIO_DEPTH_WINDOW;
+	if(_aio->windowCount < window || elapsed <= 0.0) return;
+
+	counters->throughput = _aio->windowBytes / elapsed;
+	counters->latency = _aio->windowLatency / _aio->windowCount;
+	if(counters->baseline == 0.0 || counters->latency < counters->baseline) counters->baseline = counters->latency;
+	++counters->windows;
+
+	// More requests only help while the device turns them into throughput at about the same latency,
+	// past the knee they just queue up
+	size_t depth = counters->depth;
+	bool knee = counters->latency > counters->baseline * AIO_DEPTH_KNEE;
+	if(!knee && counters->throughput > _aio->bestThroughput * AIO_DEPTH_GAIN) depth += depth / 2 + 1;
+	else if(knee) depth -= depth / 4;
+	if(depth > _aio->size) depth = _aio->size;
+	if(depth < AIO_MIN_DEPTH) depth = (_aio->size < AIO_MIN_DEPTH) ? _aio->size : AIO_MIN_DEPTH;
+
+	if(depth > counters->depth) ++counters->grows;
+	if(depth < counters->depth) ++counters->shrinks;
+	counters->depth = depth;
+	if(depth > counters->peakDepth) counters->peakDepth = depth;
+
+	// Both references fade so a change of workload or device state gets probed again
+	_aio->bestThroughput *= AIO_DEPTH_DECAY;
+	if(counters->throughput > _aio->bestThroughput) _aio->bestThroughput = counters->throughput;
+	counters->baseline *= AIO_BASELINE_DRIFT;
+
+	_aio->windowStart = *_now;
+	_aio->windowLatency = 0.0;
+	_aio->windowBytes = 0;
+	_aio->windowCount = 0;
+}
+
+static int aioReap(AIO *_aio, int _min)
+{
+	int num = 0;
+
+	if(_aio->uring) num = uringWait(_aio->uring, _aio->events, _min, _aio->size);
+	else if(_aio->pool) num = poolWait(_aio->pool, _aio->events, _min, _aio->size);
+	else
+	{
+		// Without a minimum only harvest what is already there
+		timespec zero = { 0, 0 };
+		num = io_getevents(_aio->context, _min, _aio->size, _aio->events, (_min > 0) ? NULL : &zero);
+	}
+
+	Clock now;
+	if(num > 0) clockGetTime(&now);
+
+	for(int i = 0; i < num; ++i)
+	{
+		iocb *command = _aio->events[i].obj;
+		AIOCmdBuffer *owner = (AIOCmdBuffer *) command->data;
+		if((long) _aio->events[i].res > 0) _aio->windowBytes += _aio->events[i].res;
+
+		// Resubmitted commands stay in flight
+		if(aioContinue(_aio, owner, command, (long) _aio->events[i].res)) continue;
+
+		const AIOCommand *state = owner->states + (command - owner->pool);
+		if(state->writeBehind && (long) _aio->events[i].res >= 0) aioWriteBehind(_aio, command->aio_fildes, state->offset, state->size);
+
+		for(int j = 0; j < state->members; ++j) aioComplete(owner, state[j].transfer, &now);
+		_aio->windowLatency += clockDeltaTime(&owner->submitted, &now);
+		++_aio->windowCount;
+		--_aio->inflight;
+		if(--owner->remaining == 0) aioRetire(_aio, owner);
+	}
+
+	if(num > 0 && _aio->adaptive) aioAdaptDepth(_aio, &now);
+
+	return num;
+}
+
 bool aioSubmitCmdBuffer(AIO *_aio, AIOCmdBuffer *_cmdBuffer)
 {
 	bool ret = false;
 
-	if(_aio->pending == 0)
+	if(!_cmdBuffer->pending && _aio->pendingCount < AIO_MAX_PENDING)
 	{
-		int num = io_submit(_aio->context, _cmdBuffer->count, _cmdBuffer->commands);
-		_aio->pending = _cmdBuffer;
-		ret = (num == _cmdBuffer->count);
+		// Make room for the whole command buffer within the current depth
+		if(_aio->inflight > 0 && _aio->inflight + _cmdBuffer->count > (int) _aio->counters.depth) ++_aio->counters.throttled;
+		while(_aio->inflight > 0 && _aio->inflight + _cmdBuffer->count > (int) _aio->counters.depth)
+		{
+			if(aioReap(_aio, 1) < 0) break;
+		}
+
+		// Completions find their command buffer back through the iocb user data
+		for(int i = 0; i < _cmdBuffer->count; ++i) _cmdBuffer->commands[i]->data = _cmdBuffer;
+
+		clockGetTime(&_cmdBuffer->submitted);
+		int num = aioBackendSubmit(_aio, _cmdBuffer->commands, _cmdBuffer->count);
+
+		_cmdBuffer->remaining = (num > 0) ? num : 0;
+		_cmdBuffer->failed = false;
+		_cmdBuffer->pending = true;
+
+		// Transfers that failed at recording or were refused by the queue complete right away
+		for(int i = _cmdBuffer->remaining; i < _cmdBuffer->count; ++i)
+		{
+			const AIOCommand *state = _cmdBuffer->states + (_cmdBuffer->commands[i] - _cmdBuffer->pool);
+			for(int j = 0; j < state->members; ++j)
+			{
+				AIOResult *result = &_cmdBuffer->transfers[state[j].transfer].result;
+				if(result->error == 0) result->error = EAGAIN;
+				aioComplete(_cmdBuffer, state[j].transfer, &_cmdBuffer->submitted);
+			}
+		}
+		for(int i = 0; i < _cmdBuffer->transferCount; ++i)
+		{
+			const AIOTransfer *transfer = _cmdBuffer->transfers + i;
+			if(transfer->parts == 0 && (transfer->result.error != 0 || transfer->result.requested > 0)) _cmdBuffer->failed = true;
+		}
+
+		_aio->pending[_aio->pendingCount++] = _cmdBuffer;
+		_aio->inflight += _cmdBuffer->remaining;
+
+		if(_cmdBuffer->remaining == 0) aioRetire(_aio, _cmdBuffer);
+		ret = !_cmdBuffer->failed;
 	}
 
 	return ret;
 }
 
+bool aioWaitCmdBuffer(AIO *_aio, AIOCmdBuffer *_cmdBuffer)
+{
+	while(_cmdBuffer->pending)
+	{
+		if(aioReap(_aio, 1) < 0) return false;
+	}
+
+	return !_cmdBuffer->failed;
+}
+
+bool aioPollCmdBuffer(AIO *_aio, AIOCmdBuffer *_cmdBuffer)
+{
+	if(_cmdBuffer->pending) aioReap(_aio, 0);
+	return !_cmdBuffer->pending;
+}
+
 bool aioWaitIdle(AIO *_aio)
 {
 	bool ret = true;
 
-	if(_aio->pending != 0)
+	// Wait an infinite time
+	while(_aio->pendingCount > 0)
 	{
-		int count = _aio->pending->count;
-		
-		// Wait an infinite time
-		int num = io_getevents(_aio->context, count, count, _aio->events, NULL);
+		if(aioReap(_aio, 1) < 0) { ret = false; break; }
+	}
 
-		// Close all file descriptors
-		for(int i = 0; i < _aio->pending->count; ++i)
-		{
-			int res;
-			//res = fsync(_aio->pending->commands[i]->aio_fildes);
-			res = close(_aio->pending->commands[i]->aio_fildes);
-		}
-		
-		_aio->pending = 0;
+	return ret;
+}
 
-		ret = (num == count);
-	}
+bool aioFlush(AIO *_aio)
+{
+	bool ret = aioWaitIdle(_aio);
+	aioWaitWriteback(_aio);
+
+	// Data and metadata of every written file, transient ones included
+	for(int i = 0; i < _aio->syncCount; ++i) ret = (syncfs(_aio->syncFds[i]) == 0) && ret;
 
 	return ret;
 }
 
+int aioGetResultCount(const AIOCmdBuffer *_cmdBuffer)
+{
+	return _cmdBuffer->transferCount;
+}
+
+const AIOResult *aioGetResult(const AIOCmdBuffer *_cmdBuffer, int _index)
+{
+	return (_index >= 0 && _index < _cmdBuffer->transferCount) ? &_cmdBuffer->transfers[_index].result : 0;
+}
@@ -0,0 +1,205 @@
+#include "aio_pool.h"
+#include <malloc.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#include <semaphore.h>
+
+
+const int POOL_MAX_THREADS = 64;
+const size_t POOL_CACHE_LINE = 64;
+
+struct PoolSlot
+{
+	size_t sequence;
+	io_event event;
+};
+
+// Bounded multi producer multi consumer ring, each slot sequence tells whether it is free or filled for a given lap
+struct PoolQueue
+{
+	PoolSlot *slots;
+	size_t mask;
+	alignas(POOL_CACHE_LINE) size_t head;
+	alignas(POOL_CACHE_LINE) size_t tail;
+};
+
+struct AIOPool
+{
+	PoolQueue submissions;
+	PoolQueue completions;
+	sem_t submitted;
+	sem_t completed;
+	pthread_t threads[POOL_MAX_THREADS];
+	int threadCount;
+};
+
+
+static void poolInitQueue(PoolQueue *_queue, size_t _size)
+{
+	size_t capacity = 1;
+	while(capacity < _size) capacity <<= 1;
+
+	_queue->slots = (PoolSlot *) memalign(POOL_CACHE_LINE, sizeof(PoolSlot) * capacity);
+	for(size_t i = 0; i < capacity; ++i) _queue->slots[i].sequence = i;
+	_queue->mask = capacity - 1;
+	_queue->head = 0;
+	_queue->tail = 0;
+}
+
+static bool poolPush(PoolQueue *_queue, const io_event *_event)
+{
+	PoolSlot *slot;
+	size_t pos = __atomic_load_n(&_queue->tail, __ATOMIC_RELAXED);
+	for(;;)
+	{
+		slot = _queue->slots + (pos & _queue->mask);
+		intptr_t diff = (intptr_t) __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (intptr_t) pos;
+		if(diff == 0)
+		{
+			if(__atomic_compare_exchange_n(&_queue->tail, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+		}
+		else if(diff < 0) return false; // Full
+		else pos = __atomic_load_n(&_queue->tail, __ATOMIC_RELAXED);
+	}
+
+	slot->event = *_event;
+	__atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static bool poolPop(PoolQueue *_queue, io_event *_event)
+{
+	PoolSlot *slot;
+	size_t pos = __atomic_load_n(&_queue->head, __ATOMIC_RELAXED);
+	for(;;)
+	{
+		slot = _queue->slots + (pos & _queue->mask);
+		intptr_t diff = (intptr_t) __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (intptr_t) (pos + 1);
+		if(diff == 0)
+		{
+			if(__atomic_compare_exchange_n(&_queue->head, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+		}
+		else if(diff < 0) return false; // Empty
+		else pos = __atomic_load_n(&_queue->head, __ATOMIC_RELAXED);
+	}
+
+	*_event = slot->event;
+	__atomic_store_n(&slot->sequence, pos + _queue->mask + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+static void poolPost(PoolQueue *_queue, sem_t *_semaphore, const io_event *_event)
+{
+	// Both rings hold the whole queue depth, a full one only means a consumer is about to catch up
+	while(!poolPush(_queue, _event)) sched_yield();
+	sem_post(_semaphore);
+}
+
+static void *poolWorker(void *_data)
+{
+	AIOPool *pool = (AIOPool *) _data;
+
+	for(;;)
+	{
+		if(sem_wait(&pool->submitted) != 0) continue;
+
+		io_event event;
+		if(!poolPop(&pool->submissions, &event)) continue;
+
+		// A null command asks the worker to leave
+		iocb *command = event.obj;
+		if(command == 0) break;
+
+		ssize_t res;
+		if(command->aio_lio_opcode == IO_CMD_PREADV) res = preadv(command->aio_fildes, command->u.v.vec, command->u.v.nr, command->u.v.offset);
+		else if(command->aio_lio_opcode == IO_CMD_PREAD) res = pread(command->aio_fildes, command->u.c.buf, command->u.c.nbytes, command->u.c.offset);
+		else res = pwrite(command->aio_fildes, command->u.c.buf, command->u.c.nbytes, command->u.c.offset);
+
+		event.res = (res < 0) ? -errno : res;
+		event.res2 = 0;
+		poolPost(&pool->completions, &pool->completed, &event);
+	}
+
+	return 0;
+}
+
+AIOPool *poolCreate(size_t _size, int _threads)
+{
+	if(_threads > POOL_MAX_THREADS) _threads = POOL_MAX_THREADS;
+	if(_threads > (int) _size) _threads = (int) _size;
+
+	AIOPool *pool = (AIOPool *) memalign(POOL_CACHE_LINE, sizeof(AIOPool));
+	memset(pool, 0, sizeof(AIOPool));
+	poolInitQueue(&pool->submissions, _size);
+	poolInitQueue(&pool->completions, _size);
+	sem_init(&pool->submitted, 0, 0);
+	sem_init(&pool->completed, 0, 0);
+
+	for(int i = 0; i < _threads; ++i)
+	{
+		if(pthread_create(pool->threads + i, 0, poolWorker, pool) != 0) break;
+		++pool->threadCount;
+	}
+
+	if(pool->threadCount == 0)
+	{
+		poolDestroy(pool);
+		pool = 0;
+	}
+
+	return pool;
+}
+
+void poolDestroy(AIOPool *_pool)
+{
+	io_event exit;
+	memset(&exit, 0, sizeof(io_event));
+	for(int i = 0; i < _pool->threadCount; ++i) poolPost(&_pool->submissions, &_pool->submitted, &exit);
+	for(int i = 0; i < _pool->threadCount; ++i) pthread_join(_pool->threads[i], 0);
+
+	sem_destroy(&_pool->completed);
+	sem_destroy(&_pool->submitted);
+	free(_pool->completions.slots);
+	free(_pool->submissions.slots);
+	free(_pool);
+}
+
+int poolSubmit(AIOPool *_pool, iocb **_commands, int _count)
+{
+	int num = 0;
+	for(; num < _count; ++num)
+	{
+		io_event event;
+		memset(&event, 0, sizeof(io_event));
+		event.obj = _commands[num];
+		if(!poolPush(&_pool->submissions, &event)) break;
+		sem_post(&_pool->submitted);
+	}
+
+	return (num > 0 || _count == 0) ? num : -1;
+}
+
+int poolWait(AIOPool *_pool, io_event *_events, int _min, int _max)
+{
+	// Every completion is counted once it is in the ring, a successful decrement always has one to pop
+	int num = 0;
+	while(num < _max)
+	{
+		int res = (num < _min) ? sem_wait(&_pool->completed) : sem_trywait(&_pool->completed);
+		if(res != 0)
+		{
+			if(errno == EINTR) continue;
+			break;
+		}
+
+		while(!poolPop(&_pool->completions, _events + num)) sched_yield();
+		++num;
+	}
+
+	return num;
+}
@@ -0,0 +1,13 @@
+#pragma once
+#include <stddef.h> // size_t
+#include <libaio.h> // iocb, io_event
+
+// Worker pool backend of the AIO layer, commands run as pread/pwrite on every filesystem.
+// Commands are recorded as iocb and completions are reported as io_event, like the kernel backends
+struct AIOPool;
+
+AIOPool *poolCreate(size_t _size, int _threads);
+void poolDestroy(AIOPool *_pool);
+
+int poolSubmit(AIOPool *_pool, iocb **_commands, int _count);
+int poolWait(AIOPool *_pool, io_event *_events, int _min, int _max);
@@ -0,0 +1,253 @@
+#include "aio_uring.h"
+#include <malloc.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+
+const int URING_MAX_BUFFERS = 16;
+
+struct AIOUring
+{
+	int fd;
+	unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+	unsigned *cqHead, *cqTail, *cqMask;
+	io_uring_sqe *sqes;
+	io_uring_cqe *cqes;
+	void *sqRing, *cqRing;
+	size_t sqRingSize, cqRingSize, sqesSize;
+	iovec buffers[URING_MAX_BUFFERS];
+	int bufferCount;
+	int *files;
+	unsigned fileCount;
+	unsigned fileNext;
+};
+
+
+static int uringSetup(unsigned _entries, io_uring_params *_params)
+{
+	return (int) syscall(__NR_io_uring_setup, _entries, _params);
+}
+
+static int uringEnter(int _fd, unsigned _submit, unsigned _complete, unsigned _flags)
+{
+	return (int) syscall(__NR_io_uring_enter, _fd, _submit, _complete, _flags, NULL, 0);
+}
+
+static int uringRegister(int _fd, unsigned _opcode, const void *_arg, unsigned _count)
+{
+	return (int) syscall(__NR_io_uring_register, _fd, _opcode, _arg, _count);
+}
+
+static int uringFindBuffer(const AIOUring *_uring, const void *_buffer, size_t _size)
+{
+	const char *begin = (const char *) _buffer;
+	for(int i = 0; i < _uring->bufferCount; ++i)
+	{
+		const char *base = (const char *) _uring->buffers[i].iov_base;
+		if(begin >= base && begin + _size <= base + _uring->buffers[i].iov_len) return i;
+	}
+
+	return -1;
+}
+
+AIOUring *uringCreate(size_t _size)
+{
+	io_uring_params params;
+	memset(&params, 0, sizeof(io_uring_params));
+
+	int fd = uringSetup(_size, &params);
+	if(fd < 0) return 0;
+
+	AIOUring *uring = (AIOUring *) malloc(sizeof(AIOUring));
+	memset(uring, 0, sizeof(AIOUring));
+	uring->fd = fd;
+
+	// Map submission and completion rings, they share a single mapping on recent kernels
+	uring->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	uring->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+	uring->sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+
+	bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+	if(single && uring->cqRingSize > uring->sqRingSize) uring->sqRingSize = uring->cqRingSize;
+
+	uring->sqRing = mmap(0, uring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+	uring->cqRing = single ? uring->sqRing :
+		mmap(0, uring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+	uring->sqes = (io_uring_sqe *) mmap(0, uring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+	if(uring->sqRing == MAP_FAILED || uring->cqRing == MAP_FAILED || uring->sqes == MAP_FAILED)
+	{
+		if(uring->sqes != MAP_FAILED) munmap(uring->sqes, uring->sqesSize);
+		if(!single && uring->cqRing != MAP_FAILED) munmap(uring->cqRing, uring->cqRingSize);
+		if(uring->sqRing != MAP_FAILED) munmap(uring->sqRing, uring->sqRingSize);
+		close(fd);
+		free(uring);
+		return 0;
+	}
+
+	char *sq = (char *) uring->sqRing;
+	uring->sqHead = (unsigned *) (sq + params.sq_off.head);
+	uring->sqTail = (unsigned *) (sq + params.sq_off.tail);
+	uring->sqMask = (unsigned *) (sq + params.sq_off.ring_mask);
+	uring->sqArray = (unsigned *) (sq + params.sq_off.array);
+
+	char *cq = (char *) uring->cqRing;
+	uring->cqHead = (unsigned *) (cq + params.cq_off.head);
+	uring->cqTail = (unsigned *) (cq + params.cq_off.tail);
+	uring->cqMask = (unsigned *) (cq + params.cq_off.ring_mask);
+	uring->cqes = (io_uring_cqe *) (cq + params.cq_off.cqes);
+
+	// Sparse fixed file table, one slot per submission entry, filled at submission time
+	uring->fileCount = params.sq_entries;
+	uring->files = (int *) malloc(sizeof(int) * uring->fileCount);
+	for(unsigned i = 0; i < uring->fileCount; ++i) uring->files[i] = -1;
+
+	if(uringRegister(fd, IORING_REGISTER_FILES, uring->files, uring->fileCount) < 0)
+	{
+		free(uring->files);
+		uring->files = 0;
+		uring->fileCount = 0;
+	}
+
+	return uring;
+}
+
+void uringDestroy(AIOUring *_uring)
+{
+	if(_uring->bufferCount > 0) uringRegister(_uring->fd, IORING_UNREGISTER_BUFFERS, 0, 0);
+	if(_uring->files) uringRegister(_uring->fd, IORING_UNREGISTER_FILES, 0, 0);
+
+	munmap(_uring->sqes, _uring->sqesSize);
+	if(_uring->cqRing != _uring->sqRing) munmap(_uring->cqRing, _uring->cqRingSize);
+	munmap(_uring->sqRing, _uring->sqRingSize);
+	close(_uring->fd);
+
+	free(_uring->files);
+	free(_uring);
+}
+
+bool uringRegisterBuffers(AIOUring *_uring, const iovec *_buffers, int _count)
+{
+	if(_count > URING_MAX_BUFFERS) return false;
+
+	// The kernel only accepts the whole table at once, drop the previous one first
+	if(_uring->bufferCount > 0) uringRegister(_uring->fd, IORING_UNREGISTER_BUFFERS, 0, 0);
+	_uring->bufferCount = 0;
+
+	bool ret = uringRegister(_uring->fd, IORING_REGISTER_BUFFERS, _buffers, _count) == 0;
+	if(ret)
+	{
+		memcpy(_uring->buffers, _buffers, sizeof(iovec) * _count);
+		_uring->bufferCount = _count;
+	}
+
+	return ret;
+}
+
+int uringSubmit(AIOUring *_uring, iocb **_commands, int _count)
+{
+	// Install all file descriptors of this submission with a single update,
+	// rotating through the table so submissions still in flight keep their slots
+	bool fixed = (_uring->files != 0) && (unsigned(_count) <= _uring->fileCount);
+	unsigned base = 0;
+	if(fixed)
+	{
+		if(_uring->fileNext + _count > _uring->fileCount) _uring->fileNext = 0;
+		base = _uring->fileNext;
+		_uring->fileNext += _count;
+
+		for(int i = 0; i < _count; ++i) _uring->files[base + i] = _commands[i]->aio_fildes;
+
+		io_uring_files_update update;
+		memset(&update, 0, sizeof(io_uring_files_update));
+		update.offset = base;
+		update.fds = (__u64) (_uring->files + base);
+		fixed = uringRegister(_uring->fd, IORING_REGISTER_FILES_UPDATE, &update, _count) == _count;
+	}
+
+	unsigned tail = *_uring->sqTail;
+	unsigned mask = *_uring->sqMask;
+
+	for(int i = 0; i < _count; ++i)
+	{
+		const iocb *command = _commands[i];
+		unsigned index = tail & mask;
+		io_uring_sqe *sqe = _uring->sqes + index;
+		memset(sqe, 0, sizeof(io_uring_sqe));
+
+		// Vectored reads scatter into several buffers, registered ones can't be used for them
+		bool vector = command->aio_lio_opcode == IO_CMD_PREADV;
+		bool read = command->aio_lio_opcode == IO_CMD_PREAD;
+		int buffer = vector ? -1 : uringFindBuffer(_uring, command->u.c.buf, command->u.c.nbytes);
+		if(vector) sqe->opcode = IORING_OP_READV;
+		else if(buffer >= 0)
+		{
+			sqe->opcode = read ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+			sqe->buf_index = buffer;
+		}
+		else sqe->opcode = read ? IORING_OP_READ : IORING_OP_WRITE;
+
+		if(fixed) { sqe->fd = base + i; sqe->flags = IOSQE_FIXED_FILE; }
+		else sqe->fd = command->aio_fildes;
+
+		sqe->addr = vector ? (__u64) command->u.v.vec : (__u64) command->u.c.buf;
+		sqe->len = vector ? (__u32) command->u.v.nr : (__u32) command->u.c.nbytes;
+		sqe->off = vector ? command->u.v.offset : command->u.c.offset;
+		sqe->user_data = (__u64) command;
+
+		_uring->sqArray[index] = index;
+		++tail;
+	}
+
+	__atomic_store_n(_uring->sqTail, tail, __ATOMIC_RELEASE);
+
+	int submitted = 0;
+	while(submitted < _count)
+	{
+		int res = uringEnter(_uring->fd, _count - submitted, 0, 0);
+		if(res < 0 && errno == EINTR) continue;
+		if(res <= 0) break;
+		submitted += res;
+	}
+
+	return (submitted > 0 || _count == 0) ? submitted : -1;
+}
+
+int uringWait(AIOUring *_uring, io_event *_events, int _min, int _max)
+{
+	int num = 0;
+	unsigned mask = *_uring->cqMask;
+
+	while(num < _max)
+	{
+		unsigned head = *_uring->cqHead;
+		unsigned tail = __atomic_load_n(_uring->cqTail, __ATOMIC_ACQUIRE);
+
+		if(head == tail)
+		{
+			if(num >= _min) break;
+
+			// Nothing ready yet, sleep in the kernel until the minimum count of completions arrive
+			int res = uringEnter(_uring->fd, 0, _min - num, IORING_ENTER_GETEVENTS);
+			if(res < 0 && errno != EINTR) return (num > 0) ? num : -1;
+			continue;
+		}
+
+		for(; head != tail && num < _max; ++head, ++num)
+		{
+			const io_uring_cqe *cqe = _uring->cqes + (head & mask);
+			_events[num].data = 0;
+			_events[num].obj = (iocb *) cqe->user_data;
+			_events[num].res = (long) cqe->res;
+			_events[num].res2 = 0;
+		}
+
+		__atomic_store_n(_uring->cqHead, head, __ATOMIC_RELEASE);
+	}
+
+	return num;
+}
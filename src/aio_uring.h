@@ -0,0 +1,15 @@
+#pragma once
+#include <stddef.h> // size_t
+#include <sys/uio.h> // iovec
+#include <libaio.h> // iocb, io_event
+
+// io_uring backend of the AIO layer, commands are recorded as iocb and completions are reported as io_event
+struct AIOUring;
+
+AIOUring *uringCreate(size_t _size);
+void uringDestroy(AIOUring *_uring);
+
+bool uringRegisterBuffers(AIOUring *_uring, const iovec *_buffers, int _count);
+
+int uringSubmit(AIOUring *_uring, iocb **_commands, int _count);
+int uringWait(AIOUring *_uring, io_event *_events, int _min, int _max);
@@ -0,0 +1,196 @@
+#include "codec.h"
+#include <string.h>
+
+const uint32_t LZ4_MAGIC = 0x184D2204;
+const uint32_t LZ4_SKIPPABLE_MAGIC = 0x184D2A50;
+const uint32_t LZ4_SKIPPABLE_MASK = 0xFFFFFFF0;
+const size_t LZ4_MIN_MATCH = 4;
+
+const uint32_t XXH_PRIME1 = 2654435761U;
+const uint32_t XXH_PRIME2 = 2246822519U;
+const uint32_t XXH_PRIME3 = 3266489917U;
+const uint32_t XXH_PRIME4 = 668265263U;
+const uint32_t XXH_PRIME5 = 374761393U;
+
+
+static uint32_t codecRead32(const uint8_t *_src)
+{
+	return (uint32_t) _src[0] | ((uint32_t) _src[1] << 8) | ((uint32_t) _src[2] << 16) | ((uint32_t) _src[3] << 24);
+}
+
+static uint32_t codecRotate(uint32_t _value, int _bits)
+{
+	return (_value << _bits) | (_value >> (32 - _bits));
+}
+
+uint32_t codecHashXXH32(const void *_data, size_t _size, uint32_t _seed)
+{
+	const uint8_t *src = (const uint8_t *) _data;
+	const uint8_t *end = src + _size;
+	uint32_t hash;
+
+	if(_size >= 16)
+	{
+		uint32_t v[4] = { _seed + XXH_PRIME1 + XXH_PRIME2, _seed + XXH_PRIME2, _seed, _seed - XXH_PRIME1 };
+		for(; src + 16 <= end; src += 16)
+		{
+			for(int i = 0; i < 4; ++i)
+				v[i] = codecRotate(v[i] + codecRead32(src + 4 * i) * XXH_PRIME2, 13) * XXH_PRIME1;
+		}
+		hash = codecRotate(v[0], 1) + codecRotate(v[1], 7) + codecRotate(v[2], 12) + codecRotate(v[3], 18);
+	}
+	else hash = _seed + XXH_PRIME5;
+
+	hash += (uint32_t) _size;
+	for(; src + 4 <= end; src += 4) hash = codecRotate(hash + codecRead32(src) * XXH_PRIME3, 17) * XXH_PRIME4;
+	for(; src < end; ++src) hash = codecRotate(hash + (*src) * XXH_PRIME5, 11) * XXH_PRIME1;
+
+	hash ^= hash >> 15; hash *= XXH_PRIME2;
+	hash ^= hash >> 13; hash *= XXH_PRIME3;
+	hash ^= hash >> 16;
+
+	return hash;
+}
+
+static bool codecReadLength(const uint8_t **_src, const uint8_t *_end, size_t *_length)
+{
+	// Lengths of 15 continue with bytes until one differs from 255
+	uint8_t byte = 255;
+	while(byte == 255)
+	{
+		if(*_src >= _end) return false;
+		byte = *(*_src)++;
+		*_length += byte;
+	}
+
+	return true;
+}
+
+static bool codecDecodeBlock(const uint8_t *_src, size_t _size, uint8_t *_begin, uint8_t **_dst, uint8_t *_end)
+{
+	// Matches may reach back into previous blocks, the whole output is contiguous
+	const uint8_t *src = _src, *end = _src + _size;
+	uint8_t *dst = *_dst;
+
+	while(src < end)
+	{
+		uint8_t token = *src++;
+
+		size_t literals = token >> 4;
+		if(literals == 15 && !codecReadLength(&src, end, &literals)) return false;
+		if(literals > (size_t) (end - src) || literals > (size_t) (_end - dst)) return false;
+		memcpy(dst, src, literals);
+		src += literals;
+		dst += literals;
+
+		// The last sequence only holds literals
+		if(src == end) break;
+		if(end - src < 2) return false;
+
+		size_t offset = (size_t) src[0] | ((size_t) src[1] << 8);
+		src += 2;
+		if(offset == 0 || offset > (size_t) (dst - _begin)) return false;
+
+		size_t length = token & 15;
+		if(length == 15 && !codecReadLength(&src, end, &length)) return false;
+		length += LZ4_MIN_MATCH;
+		if(length > (size_t) (_end - dst)) return false;
+
+		// Overlapping matches replicate the last bytes, they have to be copied forward one at a time
+		const uint8_t *match = dst - offset;
+		if(offset >= length) { memcpy(dst, match, length); dst += length; }
+		else for(size_t i = 0; i < length; ++i) *dst++ = match[i];
+	}
+
+	*_dst = dst;
+	return true;
+}
+
+static bool codecDecodeFrame(const uint8_t **_src, const uint8_t *_end, uint8_t *_begin, uint8_t **_dst, uint8_t *_dstEnd)
+{
+	const uint8_t *src = *_src;
+	if(_end - src < 7) return false;
+
+	const uint8_t *descriptor = src + 4;
+	uint8_t flags = descriptor[0];
+	bool blockChecksum = (flags & 0x10) != 0;
+	bool contentSize = (flags & 0x08) != 0;
+	bool contentChecksum = (flags & 0x04) != 0;
+	if((flags >> 6) != 1 || (flags & 0x01) != 0) return false; // Version 01, no dictionary
+
+	size_t descriptorSize = 2 + (contentSize ? 8 : 0);
+	if((size_t) (_end - descriptor) < descriptorSize + 1) return false;
+	if(((codecHashXXH32(descriptor, descriptorSize, 0) >> 8) & 0xFF) != descriptor[descriptorSize]) return false;
+	src = descriptor + descriptorSize + 1;
+
+	uint8_t *dst = *_dst;
+	uint8_t *first = dst;
+	for(;;)
+	{
+		if(_end - src < 4) return false;
+		uint32_t block = codecRead32(src);
+		src += 4;
+		if(block == 0) break; // End mark
+
+		size_t size = block & 0x7FFFFFFF;
+		size_t trailer = blockChecksum ? 4 : 0;
+		if(size + trailer > (size_t) (_end - src)) return false;
+		if(blockChecksum && codecHashXXH32(src, size, 0) != codecRead32(src + size)) return false;
+
+		if(block & 0x80000000)
+		{
+			// Stored uncompressed
+			if(size > (size_t) (_dstEnd - dst)) return false;
+			memcpy(dst, src, size);
+			dst += size;
+		}
+		else if(!codecDecodeBlock(src, size, _begin, &dst, _dstEnd)) return false;
+
+		src += size + trailer;
+	}
+
+	if(contentChecksum)
+	{
+		if(_end - src < 4 || codecHashXXH32(first, dst - first, 0) != codecRead32(src)) return false;
+		src += 4;
+	}
+
+	*_src = src;
+	*_dst = dst;
+	return true;
+}
+
+bool codecDecompressLZ4(const void *_src, size_t _srcSize, void *_dst, size_t _dstSize, size_t *_written)
+{
+	const uint8_t *src = (const uint8_t *) _src;
+	const uint8_t *end = src + _srcSize;
+	uint8_t *begin = (uint8_t *) _dst;
+	uint8_t *dst = begin;
+	bool ret = _srcSize >= 4;
+
+	while(ret && src < end)
+	{
+		if(end - src < 4) { ret = false; break; }
+
+		uint32_t magic = codecRead32(src);
+		if((magic & LZ4_SKIPPABLE_MASK) == LZ4_SKIPPABLE_MAGIC)
+		{
+			if(end - src < 8) { ret = false; break; }
+			size_t size = codecRead32(src + 4);
+			ret = size <= (size_t) (end - src - 8);
+			src += 8 + size;
+		}
+		else if(magic == LZ4_MAGIC) ret = codecDecodeFrame(&src, end, begin, &dst, begin + _dstSize);
+		else ret = false;
+	}
+
+	*_written = dst - begin;
+	return ret;
+}
+
+size_t codecBoundLZ4(size_t _size)
+{
+	// Header and end mark, incompressible blocks stored as is with their size and checksum, content checksum
+	const size_t blockSize = 64 << 10;
+	return 19 + 4 + 4 + _size + ((_size / blockSize) + 1) * 8;
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <stddef.h> // size_t
+#include <stdint.h> // uint32_t
+
+// Self contained LZ4 frame decoder, concatenated and skippable frames are supported, dictionaries are not.
+// Header, block and content checksums are verified when present
+bool codecDecompressLZ4(const void *_src, size_t _srcSize, void *_dst, size_t _dstSize, size_t *_written);
+
+// Worst case size of an LZ4 frame holding _size bytes
+size_t codecBoundLZ4(size_t _size);
+
+uint32_t codecHashXXH32(const void *_data, size_t _size, uint32_t _seed);
@@ -1,9 +1,11 @@
 // C std
 #include <stdio.h>
+#include <stddef.h>
 #include <string.h>
 #include <malloc.h>
 #include <assert.h>
 #include <math.h>
+#include <limits.h>
 // C++ std
 #include <vector>
 #include <string>
@@ -12,15 +14,31 @@
 #include <vulkan/vulkan.h>
 // Renderdoc
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "renderdoc_app.h"
 // Project
 #include "aio.h"
 #include "clock.h"
+#include "codec.h"
+#include "convert.h"
 #include "desc.h"
+#include "pack.h"
+#include "spirv.h"
+#include "task.h"
 
 
 static const bool VALIDATION_LAYER = true;
 static const bool DEBUG_MARKERS = true;
+static const int AIO_SCAN_BATCH = 1024;
+static const size_t PACK_ALIGNMENT = 4096;
+static const int MAX_READAHEAD = 64;
+static const int READAHEAD_DECAY = 16;
+static const char PIPELINE_CACHE_PATH[] = "pipeline.cache";
+static const char PIPELINE_CACHE_MAGIC[8] = { 'C', 'P', 'I', 'P', 'E', 'L', 'N', 'E' };
+static const uint32_t PIPELINE_CACHE_VERSION = 1;
 static const char *INSTANCE_LAYERS[] = { "VK_LAYER_KHRONOS_validation" };
 static const char *INSTANCE_EXTENSIONS[] = { 
 					VK_KHR_SURFACE_EXTENSION_NAME,
@@ -38,6 +56,33 @@ static PFN_vkSetDebugUtilsObjectTagEXT vkSetDebugUtilsObjectTag = 0;
 static PFN_vkCmdBeginDebugUtilsLabelEXT vkCmdBeginDebugUtilsLabel = 0;
 static PFN_vkCmdEndDebugUtilsLabelEXT vkCmdEndDebugUtilsLabel = 0;
 static PFN_vkCmdInsertDebugUtilsLabelEXT vkCmdInsertDebugUtilsLabel = 0;
+static PFN_vkGetMemoryHostPointerPropertiesEXT vkGetMemoryHostPointerProperties = 0;
+static PFN_vkGetShaderModuleIdentifierEXT vkGetShaderModuleIdentifier = 0;
+
+
+// Pipelines cached by the driver are only valid on the same device with the same driver build,
+// shader module identifiers additionally depend on the algorithm the driver derives them with
+struct PipelineCacheHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t vendorID;
+	uint32_t deviceID;
+	uint32_t driverVersion;
+	uint8_t deviceUUID[VK_UUID_SIZE];
+	uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+	uint8_t identifierUUID[VK_UUID_SIZE];
+	uint32_t identifierCount;
+	uint64_t dataSize;
+};
+
+struct ShaderIdentifier
+{
+	uint64_t hash;
+	uint64_t codeSize;
+	uint32_t size;
+	uint8_t identifier[VK_MAX_SHADER_MODULE_IDENTIFIER_SIZE_EXT];
+};
 
 
 struct Compute
@@ -50,19 +95,59 @@ struct Compute
 	VkCommandPool graphicsCommandPool;
 	VkCommandPool transferCommandPool;
 	VkCommandPool computeCommandPool;
-	VkDescriptorPool descriptorPool;
 	VkQueue graphicsQueue;
 	VkQueue transferQueue;
 	VkQueue computeQueue;
+	VkDeviceSize hostPointerAlignment;
+	bool hostMemory;
+	VkPipelineCache pipelineCache;
+	PipelineCacheHeader cacheKey;
+	std::vector<ShaderIdentifier> identifiers;
+	bool moduleIdentifier;
+	uint64_t timestampMasks[2];
+	double timestampPeriod;
+};
+
+struct DecodeJob
+{
+	const char *src;
+	size_t srcSize;
+	char *dst;
+	size_t dstSize;
+	bool ok;
 };
 
 struct AIOWorkload
 {
 	std::vector<std::string> files;
+	std::vector<size_t> sizes;
 	std::string path;
-	VkDeviceSize offset[2];
+	Pack *pack;
+	PackWriter *sink;
+	AIOScan *scan;
+	char *compressed[MAX_PREFETCH];
+	DecodeJob jobs[MAX_PREFETCH];
+	size_t capacity;
+	size_t fileOffset;
+	size_t stride;
+	int records;
+	char *packed[MAX_PREFETCH];
+	size_t packedSize;
+	ConvertFormat format;
+	float scale;
+	bool swap;
+	VkDeviceSize offset[MAX_PREFETCH];
 	VkDeviceSize size;
 	Access access;
+	DataCompression compression;
+	int slots;
+};
+
+struct HostMapping
+{
+	void *address;
+	size_t size;
+	VkDeviceMemory memory;
 };
 
 struct Memory
@@ -73,24 +158,66 @@ struct Memory
 	char *mapped;
 };
 
+struct PipelineJob
+{
+	Compute *compute;
+	const Program *program;
+	VkDescriptorSetLayout descriptorLayout;
+	VkPipelineLayout pipelineLayout;
+	VkPipeline pipeline;
+	VkShaderModule module;
+	ShaderIdentifier identifier;
+	VkDescriptorSet descriptorSets[2];
+};
+
+// Values of the push built-ins for the iteration being recorded
+struct PushState
+{
+	uint32_t iteration;
+	uint32_t iterations;
+	uint32_t slot;
+	uint32_t ring;
+};
+
+// One timestamp pool per slot of a command buffer ring, each pair of queries brackets a dispatch or a copy.
+// Slots are read back once their fence is waited on and reset from the host before they are submitted again
+struct QueryRing
+{
+	VkQueryPool pools[MAX_PREFETCH];
+	int slots;
+	uint32_t pairs;
+	uint64_t mask;
+	std::vector<std::vector<double>> samples;
+};
+
 struct Workflow
 {
 	VkCommandBuffer graphicsCmdBuffers[2];
 	VkCommandBuffer graphicsQFOTCmdBuffers[2];
-	VkCommandBuffer transferCmdBuffers[2];
+	VkCommandBuffer transferCmdBuffers[MAX_PREFETCH];
 	VkCommandBuffer transferUniqueCmdBuffers[2];
 	VkCommandBuffer computeCmdBuffers[2];
 	std::vector<AIOWorkload> aioWorkload;
 	std::vector<AIOWorkload> aioUniqueWorkload;
 
 	Memory memory[Access_Count] = {0};
-	VkDescriptorSet computeDescriptors[2];
+	VkDescriptorPool descriptorPool;
 	std::vector<VkBuffer> buffers;
 	std::vector<VkPipeline> pipelines;
 	std::vector<VkShaderModule> shaderModules;
 	std::vector<VkDescriptorSetLayout> descriptorLayouts;
 	std::vector<VkPipelineLayout> pipelineLayouts;
 	std::vector<VkFence> fences;
+	std::vector<HostMapping> hostMappings;
+	std::vector<PipelineJob> pipelineJobs;
+	TaskGroup pipelineGroup;
+	VkDescriptorBufferInfo bufferInfos[2][MAX_BINDINGS];
+	PushState push;
+	bool dynamicPush;
+	QueryRing graphicsQueries;
+	QueryRing transferQueries;
+	std::vector<int> transferItems;
+	int prefetch;
 };
 
 
@@ -126,6 +253,110 @@ static int32_t findProperties(const VkPhysicalDeviceMemoryProperties* pMemoryPro
     return -1;
 }
 
+static void *loadFile(const char *_name, size_t *_size)
+{
+	size_t size = 0;
+	void *buffer = 0;	
+	FILE *fp = fopen(_name, "rb");
+
+	if(fp != 0)
+	{
+		fseek(fp, 0, SEEK_END);
+		size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+		buffer = malloc(size);
+		size_t read = fread(buffer, 1, size, fp);
+		fclose(fp);
+	}
+
+	*_size = size;	
+	return buffer;
+}
+
+
+static uint64_t hashCode(const void *_code, size_t _size)
+{
+	// FNV-1a, identifiers are looked up by content so renamed or rebuilt shaders never match stale entries
+	uint64_t hash = 0xcbf29ce484222325ull;
+	const unsigned char *bytes = (const unsigned char *) _code;
+	for(size_t i = 0; i < _size; ++i) hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+	return hash;
+}
+
+static const ShaderIdentifier *findShaderIdentifier(const Compute *_compute, uint64_t _hash, size_t _codeSize)
+{
+	for(const ShaderIdentifier &identifier : _compute->identifiers)
+		if(identifier.hash == _hash && identifier.codeSize == _codeSize) return &identifier;
+	return 0;
+}
+
+static void loadPipelineCache(Compute *_compute)
+{
+	size_t size = 0;
+	void *blob = loadFile(PIPELINE_CACHE_PATH, &size);
+	const PipelineCacheHeader *header = (const PipelineCacheHeader *) blob;
+
+	// Another device, driver or identifier algorithm invalidates the whole file
+	bool valid = blob != 0 && size >= sizeof(PipelineCacheHeader) &&
+		memcmp(header, &_compute->cacheKey, offsetof(PipelineCacheHeader, identifierCount)) == 0 &&
+		size == sizeof(PipelineCacheHeader) + header->identifierCount * sizeof(ShaderIdentifier) + header->dataSize;
+	if(blob != 0 && !valid) printf("[Info] Pipeline cache %s doesn't match this device, rebuilding it\n", PIPELINE_CACHE_PATH);
+
+	const ShaderIdentifier *identifiers = (const ShaderIdentifier *) (header + 1);
+	if(valid && _compute->moduleIdentifier)
+		_compute->identifiers.assign(identifiers, identifiers + header->identifierCount);
+
+	VkPipelineCacheCreateInfo createInfo;
+	memset(&createInfo, 0, sizeof(VkPipelineCacheCreateInfo));
+	createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+	createInfo.initialDataSize = valid ? header->dataSize : 0;
+	createInfo.pInitialData = valid ? identifiers + header->identifierCount : 0;
+	if(vkCreatePipelineCache(_compute->device, &createInfo, 0, &_compute->pipelineCache) != VK_SUCCESS)
+		_compute->pipelineCache = VK_NULL_HANDLE;
+
+	free(blob);
+}
+
+static bool savePipelineCache(Compute *_compute)
+{
+	if(_compute->pipelineCache == VK_NULL_HANDLE) return false;
+
+	size_t dataSize = 0;
+	vkGetPipelineCacheData(_compute->device, _compute->pipelineCache, &dataSize, 0);
+
+	PipelineCacheHeader header = _compute->cacheKey;
+	header.identifierCount = _compute->identifiers.size();
+	size_t identifierSize = header.identifierCount * sizeof(ShaderIdentifier);
+
+	char *buffer = (char *) malloc(sizeof(PipelineCacheHeader) + identifierSize + dataSize);
+	char *data = buffer + sizeof(PipelineCacheHeader) + identifierSize;
+	bool result = vkGetPipelineCacheData(_compute->device, _compute->pipelineCache, &dataSize, data) == VK_SUCCESS;
+	header.dataSize = dataSize;
+	memcpy(buffer, &header, sizeof(PipelineCacheHeader));
+	if(identifierSize > 0) memcpy(buffer + sizeof(PipelineCacheHeader), _compute->identifiers.data(), identifierSize);
+
+	// Written aside then renamed, concurrent runs never load a partial file
+	char temp[PATH_MAX];
+	snprintf(temp, PATH_MAX, "%s.%d", PIPELINE_CACHE_PATH, (int) getpid());
+
+	size_t size = sizeof(PipelineCacheHeader) + identifierSize + dataSize;
+	FILE *fp = result ? fopen(temp, "wb") : 0;
+	result = fp != 0;
+	if(fp)
+	{
+		result = fwrite(buffer, 1, size, fp) == size;
+		result = (fclose(fp) == 0) && result;
+		result = result && rename(temp, PIPELINE_CACHE_PATH) == 0;
+		if(!result) unlink(temp);
+	}
+
+	if(!result) printf("[Warning] Failed to save pipeline cache %s\n", PIPELINE_CACHE_PATH);
+
+	free(buffer);
+	return result;
+}
+
+
 int computeCreate(Compute *_compute)
 {
 	int result = 1;
@@ -218,11 +449,91 @@ int computeCreate(Compute *_compute)
 		VkExtensionProperties extensionProperties[64];
 		vkEnumerateDeviceExtensionProperties(_compute->physicalDevice, 0, &extensionCount, extensionProperties);
 
+		_compute->hostMemory = false;
+		_compute->moduleIdentifier = false;
 		printf("Physical device extensions:\n");
 		for(uint32_t i = 0; i < extensionCount; ++i)
 		{
 			printf("%d. %s\n", i, extensionProperties[i].extensionName);
+			if(strcmp(extensionProperties[i].extensionName, VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME) == 0)
+				_compute->hostMemory = true;
+			if(strcmp(extensionProperties[i].extensionName, VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME) == 0)
+				_compute->moduleIdentifier = true;
+		}
+	}
+
+	// Timestamp queries are reset from the host once read, core since Vulkan 1.2
+	VkPhysicalDeviceVulkan12Features features12;
+	memset(&features12, 0, sizeof(VkPhysicalDeviceVulkan12Features));
+	features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+	// Shader module identifiers need pipeline creation cache control, core since Vulkan 1.3
+	VkPhysicalDeviceVulkan13Features features13;
+	memset(&features13, 0, sizeof(VkPhysicalDeviceVulkan13Features));
+	features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	features13.pNext = &features12;
+
+	VkPhysicalDeviceShaderModuleIdentifierFeaturesEXT identifierFeatures;
+	memset(&identifierFeatures, 0, sizeof(VkPhysicalDeviceShaderModuleIdentifierFeaturesEXT));
+	identifierFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_MODULE_IDENTIFIER_FEATURES_EXT;
+	identifierFeatures.pNext = &features13;
+
+	// Key of the on-disk pipeline cache
+	{
+		VkPhysicalDeviceShaderModuleIdentifierPropertiesEXT identifierProperties;
+		memset(&identifierProperties, 0, sizeof(VkPhysicalDeviceShaderModuleIdentifierPropertiesEXT));
+		identifierProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_MODULE_IDENTIFIER_PROPERTIES_EXT;
+
+		VkPhysicalDeviceIDProperties idProperties;
+		memset(&idProperties, 0, sizeof(VkPhysicalDeviceIDProperties));
+		idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+		idProperties.pNext = _compute->moduleIdentifier ? &identifierProperties : 0;
+
+		VkPhysicalDeviceProperties2 properties;
+		memset(&properties, 0, sizeof(VkPhysicalDeviceProperties2));
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &idProperties;
+		vkGetPhysicalDeviceProperties2(_compute->physicalDevice, &properties);
+
+		uint32_t apiVersion = properties.properties.apiVersion;
+		if(apiVersion >= VK_API_VERSION_1_2)
+		{
+			VkPhysicalDeviceFeatures2 features;
+			memset(&features, 0, sizeof(VkPhysicalDeviceFeatures2));
+			features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+			features.pNext = (apiVersion < VK_API_VERSION_1_3) ? (void *) &features12 : 
+								_compute->moduleIdentifier ? (void *) &identifierFeatures : (void *) &features13;
+			vkGetPhysicalDeviceFeatures2(_compute->physicalDevice, &features);
 		}
+		_compute->moduleIdentifier = identifierFeatures.shaderModuleIdentifier && features13.pipelineCreationCacheControl;
+		_compute->timestampPeriod = properties.properties.limits.timestampPeriod;
+
+		PipelineCacheHeader *key = &_compute->cacheKey;
+		memset(key, 0, sizeof(PipelineCacheHeader));
+		memcpy(key->magic, PIPELINE_CACHE_MAGIC, sizeof(PIPELINE_CACHE_MAGIC));
+		key->version = PIPELINE_CACHE_VERSION;
+		key->vendorID = properties.properties.vendorID;
+		key->deviceID = properties.properties.deviceID;
+		key->driverVersion = properties.properties.driverVersion;
+		memcpy(key->deviceUUID, idProperties.deviceUUID, VK_UUID_SIZE);
+		memcpy(key->pipelineCacheUUID, properties.properties.pipelineCacheUUID, VK_UUID_SIZE);
+		if(_compute->moduleIdentifier)
+			memcpy(key->identifierUUID, identifierProperties.shaderModuleIdentifierAlgorithmUUID, VK_UUID_SIZE);
+	}
+
+	// Imported host pointers and sizes must respect this alignment
+	if(_compute->hostMemory)
+	{
+		VkPhysicalDeviceExternalMemoryHostPropertiesEXT hostProperties;
+		memset(&hostProperties, 0, sizeof(VkPhysicalDeviceExternalMemoryHostPropertiesEXT));
+		hostProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_EXTERNAL_MEMORY_HOST_PROPERTIES_EXT;
+
+		VkPhysicalDeviceProperties2 properties;
+		memset(&properties, 0, sizeof(VkPhysicalDeviceProperties2));
+		properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+		properties.pNext = &hostProperties;
+		vkGetPhysicalDeviceProperties2(_compute->physicalDevice, &properties);
+		_compute->hostPointerAlignment = hostProperties.minImportedHostPointerAlignment;
 	}
 
 	// Enumerate memory properties
@@ -246,6 +557,14 @@ int computeCreate(Compute *_compute)
 		{
 			printf("%d. flg:0x%x, cnt:%d\n", i, queueFamilies[i].queueFlags, queueFamilies[i].queueCount);
 		}
+
+		// Graphics and transfer queues are profiled when they have timestamps and queries can be reset from the host
+		for(uint32_t i = 0; i < 2; ++i)
+		{
+			uint32_t bits = (i < queueFamilyCount && features12.hostQueryReset) ? queueFamilies[i].timestampValidBits : 0;
+			_compute->timestampMasks[i] = (bits >= 64) ? ~0ull : (1ull << bits) - 1;
+		}
+		if(!features12.hostQueryReset) printf("[Warning] Vulkan host query reset is not supported, GPU timings are disabled\n");
 	}
 
 	// Create device
@@ -278,8 +597,30 @@ int computeCreate(Compute *_compute)
 		createInfo.pQueueCreateInfos = queueCreateInfos;
 		createInfo.queueCreateInfoCount = sizeof(queueCreateInfos) / sizeof(VkDeviceQueueCreateInfo);
 		createInfo.pEnabledFeatures = &deviceFeatures;
-		createInfo.enabledExtensionCount = sizeof(DEVICE_EXTENSIONS) / sizeof(const char *);
-		createInfo.ppEnabledExtensionNames = DEVICE_EXTENSIONS;
+		// Optional extensions are only enabled when the device exposes them
+		const uint32_t baseCount = sizeof(DEVICE_EXTENSIONS) / sizeof(const char *);
+		const char *deviceExtensions[baseCount + 2];
+		uint32_t deviceExtensionCount = baseCount;
+		memcpy(deviceExtensions, DEVICE_EXTENSIONS, sizeof(DEVICE_EXTENSIONS));
+		if(_compute->hostMemory) deviceExtensions[deviceExtensionCount++] = VK_EXT_EXTERNAL_MEMORY_HOST_EXTENSION_NAME;
+		bool hostQueryReset = features12.hostQueryReset;
+		memset(&features12, 0, sizeof(VkPhysicalDeviceVulkan12Features));
+		features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+		features12.hostQueryReset = hostQueryReset;
+		if(hostQueryReset) createInfo.pNext = &features12;
+		if(_compute->moduleIdentifier)
+		{
+			deviceExtensions[deviceExtensionCount++] = VK_EXT_SHADER_MODULE_IDENTIFIER_EXTENSION_NAME;
+			identifierFeatures.shaderModuleIdentifier = VK_TRUE;
+			memset(&features13, 0, sizeof(VkPhysicalDeviceVulkan13Features));
+			features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+			features13.pipelineCreationCacheControl = VK_TRUE;
+			features13.pNext = hostQueryReset ? &features12 : 0;
+			createInfo.pNext = &identifierFeatures;
+		}
+
+		createInfo.enabledExtensionCount = deviceExtensionCount;
+		createInfo.ppEnabledExtensionNames = deviceExtensions;
 
 		vkCreateDevice(_compute->physicalDevice, &createInfo, 0, &_compute->device);
 		vkGetDeviceQueue(_compute->device, 0, 0, &_compute->graphicsQueue);
@@ -300,32 +641,22 @@ int computeCreate(Compute *_compute)
 		vkCreateCommandPool(_compute->device, &poolInfo, 0, &_compute->computeCommandPool);
 	}
 
-	// Create descriptor set pool
-	{
-		VkDescriptorPoolSize poolSizes[6];
-		memset(&poolSizes, 0, sizeof(poolSizes));
-		poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-		poolSizes[0].descriptorCount = 32;
-		poolSizes[1].type = VK_DESCRIPTOR_TYPE_SAMPLER;
-		poolSizes[1].descriptorCount = 32;
-		poolSizes[2].type = VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
-		poolSizes[2].descriptorCount = 32;
-		poolSizes[3].type = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
-		poolSizes[3].descriptorCount = 32;
-		poolSizes[4].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		poolSizes[4].descriptorCount = 32;
-		poolSizes[5].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-		poolSizes[5].descriptorCount = 32;
-
-		VkDescriptorPoolCreateInfo poolInfo;
-		memset(&poolInfo, 0, sizeof(VkDescriptorPoolCreateInfo));
-		poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-		poolInfo.poolSizeCount = sizeof(poolSizes) / sizeof(VkDescriptorPoolSize);
-		poolInfo.pPoolSizes = poolSizes;
-		poolInfo.maxSets = 32;
-		vkCreateDescriptorPool(_compute->device, &poolInfo, 0, &_compute->descriptorPool);
+	if(_compute->hostMemory)
+	{
+		vkGetMemoryHostPointerProperties = (PFN_vkGetMemoryHostPointerPropertiesEXT) vkGetDeviceProcAddr(_compute->device,
+				"vkGetMemoryHostPointerPropertiesEXT");
+		_compute->hostMemory = vkGetMemoryHostPointerProperties != 0;
+	}
+
+	if(_compute->moduleIdentifier)
+	{
+		vkGetShaderModuleIdentifier = (PFN_vkGetShaderModuleIdentifierEXT) vkGetDeviceProcAddr(_compute->device,
+				"vkGetShaderModuleIdentifierEXT");
+		_compute->moduleIdentifier = vkGetShaderModuleIdentifier != 0;
 	}
 
+	loadPipelineCache(_compute);
+
 	if(DEBUG_MARKERS)
 	{
 		vkSetDebugUtilsObjectName = (PFN_vkSetDebugUtilsObjectNameEXT) vkGetDeviceProcAddr(_compute->device, 
@@ -344,34 +675,13 @@ int computeCreate(Compute *_compute)
 }
 
 
-static void *loadFile(const char *_name, size_t *_size)
-{
-	size_t size = 0;
-	void *buffer = 0;	
-	FILE *fp = fopen(_name, "rb");
-
-	if(fp != 0)
-	{
-		fseek(fp, 0, SEEK_END);
-		size = ftell(fp);
-		fseek(fp, 0, SEEK_SET);
-		buffer = malloc(size);
-		size_t read = fread(buffer, 1, size, fp);
-		fclose(fp);
-	}
-
-	*_size = size;	
-	return buffer;
-}
-
-
 void computeDestroy(Compute *_compute)
 {
 	vkDeviceWaitIdle(_compute->device);
+	vkDestroyPipelineCache(_compute->device, _compute->pipelineCache, 0);
 	vkDestroyCommandPool(_compute->device, _compute->graphicsCommandPool, 0);
 	vkDestroyCommandPool(_compute->device, _compute->transferCommandPool, 0);
 	vkDestroyCommandPool(_compute->device, _compute->computeCommandPool, 0);
-	vkDestroyDescriptorPool(_compute->device, _compute->descriptorPool, 0);
 	vkDestroyDevice(_compute->device, 0);
 
 	if(VALIDATION_LAYER)
@@ -387,18 +697,39 @@ void computeDestroy(Compute *_compute)
 
 void computeDestroyWorkflow(Compute *_compute, Workflow *_workflow)
 {
+	savePipelineCache(_compute);
+
 	for(VkBuffer &buffer : _workflow->buffers)
 		vkDestroyBuffer(_compute->device, buffer, 0);
 	for(VkPipeline &pipeline : _workflow->pipelines)
 		vkDestroyPipeline(_compute->device, pipeline, 0);
 	for(VkShaderModule &module : _workflow->shaderModules)
 		vkDestroyShaderModule(_compute->device, module, 0);
+	vkDestroyDescriptorPool(_compute->device, _workflow->descriptorPool, 0);
 	for(VkDescriptorSetLayout &descLayout : _workflow->descriptorLayouts)
 		vkDestroyDescriptorSetLayout(_compute->device, descLayout, 0);
 	for(VkPipelineLayout &pipelineLayout : _workflow->pipelineLayouts)
 		vkDestroyPipelineLayout(_compute->device, pipelineLayout, 0);
 	for(VkFence &fence : _workflow->fences)
 		vkDestroyFence(_compute->device, fence, 0);
+	for(int s = 0; s < _workflow->graphicsQueries.slots; ++s)
+		vkDestroyQueryPool(_compute->device, _workflow->graphicsQueries.pools[s], 0);
+	for(int s = 0; s < _workflow->transferQueries.slots; ++s)
+		vkDestroyQueryPool(_compute->device, _workflow->transferQueries.pools[s], 0);
+	for(AIOWorkload &workload : _workflow->aioWorkload)
+	{
+		if(workload.pack) packClose(workload.pack);
+		if(workload.sink) packDestroy(workload.sink);
+		if(workload.scan) aioEndScan(workload.scan);
+		for(int s = 0; s < workload.slots; ++s) { free(workload.compressed[s]); free(workload.packed[s]); }
+	}
+	for(AIOWorkload &workload : _workflow->aioUniqueWorkload)
+		for(int s = 0; s < workload.slots; ++s) { free(workload.compressed[s]); free(workload.packed[s]); }
+	for(HostMapping &mapping : _workflow->hostMappings)
+	{
+		vkFreeMemory(_compute->device, mapping.memory, 0);
+		if(mapping.address) munmap(mapping.address, mapping.size);
+	}
 	for(int i = 0; i < Access_Count; ++i)
 	{
 		if(_workflow->memory[i].mapped)
@@ -459,8 +790,17 @@ static void allocateMemory(Compute *_compute, Workflow *_workflow, const Descrip
 		allocInfo.memoryTypeIndex = findProperties(&_compute->memoryProperties, memory.memoryTypeBits, accessToMemoryFlags(Access(i)));
 		//printf("Memory type chosen: %d\n", allocInfo.memoryTypeIndex);
 
-		_workflow->memory[i].alignment = memory.alignment;
+		// Never go below the pool layout accounted by desc, staging slots stay usable for direct I/O
+		_workflow->memory[i].alignment = (memory.alignment > SAFE_ALIGNMENT) ? memory.alignment : SAFE_ALIGNMENT;
 		allocInfo.allocationSize = _desc->parameters.poolSizes[i];
+
+		// Memory items are placed by desc in SAFE_ALIGNMENT units, a coarser device alignment scales the whole layout
+		if(i == Access_GPU_ReadWrite && _workflow->memory[i].alignment > SAFE_ALIGNMENT)
+		{
+			allocInfo.allocationSize = allocInfo.allocationSize / SAFE_ALIGNMENT * _workflow->memory[i].alignment;
+			printf("[Warning] Device buffers need %lu byte alignment, memory items take %lu KiB instead of %lu KiB\n", 
+				(size_t) _workflow->memory[i].alignment, (size_t) allocInfo.allocationSize / 1024, _desc->parameters.poolSizes[i] / 1024);
+		}
 		vkAllocateMemory(_compute->device, &allocInfo, 0, &_workflow->memory[i].memory);
 	}
 
@@ -484,22 +824,16 @@ static void allocateCommandBuffers(Compute *_compute, VkCommandPool _commandPool
 	vkAllocateCommandBuffers(_compute->device, &allocInfo, _commandBuffers);
 }
 
-static void createShaderModule(Compute *_compute, Workflow *_workflow, 
-	const char *_filename, VkShaderModule *_module, const char *_name = "")
+static void createShaderModule(Compute *_compute, const void *_code, size_t _size, 
+	VkShaderModule *_module, const char *_name = "")
 {
-	size_t size = 0;
-	void *blob = loadFile(_filename, &size);
-
 	VkShaderModuleCreateInfo createInfo;
 	memset(&createInfo, 0, sizeof(VkShaderModuleCreateInfo));
 	createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-	createInfo.codeSize = size;
-	createInfo.pCode = (const uint32_t*) blob;
+	createInfo.codeSize = _size;
+	createInfo.pCode = (const uint32_t*) _code;
 
 	vkCreateShaderModule(_compute->device, &createInfo, 0, _module);
-	_workflow->shaderModules.push_back(*_module);
-
-	free(blob);
 
 	if(DEBUG_MARKERS)
 	{
@@ -523,6 +857,23 @@ static void createFence(Compute *_compute, Workflow *_workflow, VkFence *_fence)
 	_workflow->fences.push_back(*_fence);
 }
 
+static void createDescriptorPool(Compute *_compute, Workflow *_workflow, int _sets, int _descriptors)
+{
+	// Only storage buffers are bound, the pool holds exactly what the programs need
+	VkDescriptorPoolSize poolSize;
+	memset(&poolSize, 0, sizeof(VkDescriptorPoolSize));
+	poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSize.descriptorCount = (_descriptors > 0) ? _descriptors : 1;
+
+	VkDescriptorPoolCreateInfo poolInfo;
+	memset(&poolInfo, 0, sizeof(VkDescriptorPoolCreateInfo));
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+	poolInfo.maxSets = (_sets > 0) ? _sets : 1;
+	vkCreateDescriptorPool(_compute->device, &poolInfo, 0, &_workflow->descriptorPool);
+}
+
 static void createDescriptorLayout(Compute *_compute, Workflow *_workflow, 
 	const VkDescriptorSetLayoutBinding *_bindings, int _count, VkDescriptorSetLayout *_descriptorLayout)
 {
@@ -535,43 +886,122 @@ static void createDescriptorLayout(Compute *_compute, Workflow *_workflow,
 	_workflow->descriptorLayouts.push_back(*_descriptorLayout);
 }
 
-static void createComputePipeline(Compute *_compute, Workflow *_workflow, 
-	const VkShaderModule *_module, const VkPipelineLayout *_layout, VkPipeline *_pipeline)
+static void createComputePipeline(PipelineJob *_job)
 {
+	// Runs on a worker, results stay in the job until the workflow collects them
+	Compute *compute = _job->compute;
+	const Program *program = _job->program;
+
+	// Compiled workflows already hold the SPIR-V in their mapping
+	size_t size = program->codeSize;
+	void *blob = program->code ? 0 : loadFile(program->path, &size);
+	const void *code = program->code ? program->code : blob;
+	uint64_t hash = hashCode(code, size);
+
+	// Constants are laid out in 8 byte slots, the driver reads the leading size bytes of each (little endian)
+	std::vector<VkSpecializationMapEntry> entries(program->constantCount);
+	std::vector<uint64_t> values(program->constantCount);
+	for(int c = 0; c < program->constantCount; ++c)
+	{
+		entries[c].constantID = program->constants[c].id;
+		entries[c].offset = c * sizeof(uint64_t);
+		entries[c].size = program->constants[c].size;
+		values[c] = program->constants[c].value;
+	}
+
+	VkSpecializationInfo specialization;
+	memset(&specialization, 0, sizeof(VkSpecializationInfo));
+	specialization.mapEntryCount = program->constantCount;
+	specialization.pMapEntries = entries.data();
+	specialization.dataSize = values.size() * sizeof(uint64_t);
+	specialization.pData = values.data();
+
 	VkPipelineShaderStageCreateInfo shaderStage;
 	memset(&shaderStage, 0, sizeof(shaderStage));
 	shaderStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
 	shaderStage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
-	shaderStage.module = *_module;
 	shaderStage.pName = "main";
+	shaderStage.pSpecializationInfo = (program->constantCount > 0) ? &specialization : 0;
 
 	VkComputePipelineCreateInfo pipelineInfo;
 	memset(&pipelineInfo, 0, sizeof(VkComputePipelineCreateInfo));
 	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
-	pipelineInfo.stage = shaderStage;
-	pipelineInfo.layout = *_layout;
+	pipelineInfo.layout = _job->pipelineLayout;
 	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
 	pipelineInfo.basePipelineIndex = -1;
-	vkCreateComputePipelines(_compute->device, VK_NULL_HANDLE, 1, &pipelineInfo, 0, _pipeline);
-	_workflow->pipelines.push_back(*_pipeline);
+
+	// A module seen by a previous run is referenced by its identifier, neither parsed nor compiled
+	// as long as the pipeline is still in the cache, otherwise the module is created as usual
+	VkResult result = VK_PIPELINE_COMPILE_REQUIRED;
+	const ShaderIdentifier *known = compute->moduleIdentifier ? findShaderIdentifier(compute, hash, size) : 0;
+	if(known)
+	{
+		VkPipelineShaderStageModuleIdentifierCreateInfoEXT identifierInfo;
+		memset(&identifierInfo, 0, sizeof(VkPipelineShaderStageModuleIdentifierCreateInfoEXT));
+		identifierInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_MODULE_IDENTIFIER_CREATE_INFO_EXT;
+		identifierInfo.identifierSize = known->size;
+		identifierInfo.pIdentifier = known->identifier;
+
+		shaderStage.pNext = &identifierInfo;
+		shaderStage.module = VK_NULL_HANDLE;
+		pipelineInfo.stage = shaderStage;
+		pipelineInfo.flags = VK_PIPELINE_CREATE_FAIL_ON_PIPELINE_COMPILE_REQUIRED_BIT;
+		result = vkCreateComputePipelines(compute->device, compute->pipelineCache, 1, &pipelineInfo, 0, &_job->pipeline);
+	}
+
+	_job->module = VK_NULL_HANDLE;
+	memset(&_job->identifier, 0, sizeof(ShaderIdentifier));
+	if(result != VK_SUCCESS)
+	{
+		createShaderModule(compute, code, size, &_job->module, program->path);
+
+		shaderStage.pNext = 0;
+		shaderStage.module = _job->module;
+		pipelineInfo.stage = shaderStage;
+		pipelineInfo.flags = 0;
+		vkCreateComputePipelines(compute->device, compute->pipelineCache, 1, &pipelineInfo, 0, &_job->pipeline);
+
+		if(compute->moduleIdentifier && !known)
+		{
+			VkShaderModuleIdentifierEXT identifier;
+			memset(&identifier, 0, sizeof(VkShaderModuleIdentifierEXT));
+			identifier.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_IDENTIFIER_EXT;
+			vkGetShaderModuleIdentifier(compute->device, _job->module, &identifier);
+
+			_job->identifier.hash = hash;
+			_job->identifier.codeSize = size;
+			_job->identifier.size = (identifier.identifierSize < VK_MAX_SHADER_MODULE_IDENTIFIER_SIZE_EXT) ?
+				identifier.identifierSize : VK_MAX_SHADER_MODULE_IDENTIFIER_SIZE_EXT;
+			memcpy(_job->identifier.identifier, identifier.identifier, _job->identifier.size);
+		}
+	}
+
+	free(blob);
+}
+
+static void pipelineTask(void *_data)
+{
+	createComputePipeline((PipelineJob *) _data);
 }
 
 static void createPipelineLayout(Compute *_compute, Workflow *_workflow, 
-	const VkDescriptorSetLayout *_descriptorLayout, VkPipelineLayout *_pipelineLayout)
+	const VkDescriptorSetLayout *_descriptorLayout, uint32_t _pushSize, VkPipelineLayout *_pipelineLayout)
 {
+	VkPushConstantRange pushRange = { VK_SHADER_STAGE_COMPUTE_BIT, 0, _pushSize };
+
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo;
 	memset(&pipelineLayoutInfo, 0, sizeof(VkPipelineLayoutCreateInfo));
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
 	pipelineLayoutInfo.setLayoutCount = 1;
 	pipelineLayoutInfo.pSetLayouts = _descriptorLayout;
-	pipelineLayoutInfo.pushConstantRangeCount = 0;
-	pipelineLayoutInfo.pPushConstantRanges = 0;
+	pipelineLayoutInfo.pushConstantRangeCount = (_pushSize > 0) ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = (_pushSize > 0) ? &pushRange : 0;
 	vkCreatePipelineLayout(_compute->device, &pipelineLayoutInfo, 0, _pipelineLayout);
 	_workflow->pipelineLayouts.push_back(*_pipelineLayout);
 }
 
-static void createBuffer(Compute *_compute, Workflow *_workflow, VkDeviceSize _size, Access _access, 
-	VkBuffer *_buffer, VkDeviceSize *_offset, const char *_name = "")
+static void createPlacedBuffer(Compute *_compute, Workflow *_workflow, VkDeviceSize _size, Access _access, 
+	VkDeviceSize _offset, VkBuffer *_buffer, const char *_name = "")
 {
 	VkBufferCreateInfo bufferInfo;
 	memset(&bufferInfo, 0, sizeof(VkBufferCreateInfo));
@@ -583,14 +1013,169 @@ static void createBuffer(Compute *_compute, Workflow *_workflow, VkDeviceSize _s
 	_workflow->buffers.push_back(*_buffer);
 
 	Memory *memory = _workflow->memory + _access;
-	vkBindBufferMemory(_compute->device, *_buffer, memory->memory, memory->offset);
+	vkBindBufferMemory(_compute->device, *_buffer, memory->memory, _offset);
+
+	if(DEBUG_MARKERS)
+	{
+		VkDebugUtilsObjectNameInfoEXT nameInfo;
+		memset(&nameInfo, 0, sizeof(VkDebugMarkerObjectNameInfoEXT));
+		nameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+		nameInfo.objectType = VK_OBJECT_TYPE_BUFFER;
+		nameInfo.objectHandle = (uint64_t) *_buffer;
+		nameInfo.pObjectName = _name;
+		vkSetDebugUtilsObjectName(_compute->device, &nameInfo);
+	}
+}
+
+static void createBuffer(Compute *_compute, Workflow *_workflow, VkDeviceSize _size, Access _access, 
+	VkBuffer *_buffer, VkDeviceSize *_offset, const char *_name = "")
+{
+	Memory *memory = _workflow->memory + _access;
+	createPlacedBuffer(_compute, _workflow, _size, _access, memory->offset, _buffer, _name);
 	*_offset = memory->offset;
 
 	// Keep next offset aligned
 	VkDeviceSize asize = _size & (~(memory->alignment - 1));
 	memory->offset += (_size == asize) ? asize : asize + memory->alignment;
+}
 
-	if(DEBUG_MARKERS)
+static bool importHostFile(Compute *_compute, Workflow *_workflow, void *_address, size_t _size, 
+	VkBuffer *_buffer, bool *_deviceLocal)
+{
+	if(!_compute->hostMemory) return false;
+
+	VkMemoryHostPointerPropertiesEXT pointerProperties;
+	memset(&pointerProperties, 0, sizeof(VkMemoryHostPointerPropertiesEXT));
+	pointerProperties.sType = VK_STRUCTURE_TYPE_MEMORY_HOST_POINTER_PROPERTIES_EXT;
+	if(vkGetMemoryHostPointerProperties(_compute->device, VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT, 
+		_address, &pointerProperties) != VK_SUCCESS) return false;
+
+	VkExternalMemoryBufferCreateInfo externalInfo;
+	memset(&externalInfo, 0, sizeof(VkExternalMemoryBufferCreateInfo));
+	externalInfo.sType = VK_STRUCTURE_TYPE_EXTERNAL_MEMORY_BUFFER_CREATE_INFO;
+	externalInfo.handleTypes = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+
+	VkBufferCreateInfo bufferInfo;
+	memset(&bufferInfo, 0, sizeof(VkBufferCreateInfo));
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.pNext = &externalInfo;
+	bufferInfo.size = _size;
+	bufferInfo.usage = accessToBufferUsage(Access_CPU_Write) | accessToBufferUsage(Access_GPU_Read);
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if(vkCreateBuffer(_compute->device, &bufferInfo, 0, _buffer) != VK_SUCCESS) return false;
+
+	// Device local host memory means UMA, shaders can then read the mapping directly
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(_compute->device, *_buffer, &requirements);
+	uint32_t typeBits = requirements.memoryTypeBits & pointerProperties.memoryTypeBits;
+	int32_t typeIndex = findProperties(&_compute->memoryProperties, typeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+	*_deviceLocal = typeIndex >= 0;
+	if(typeIndex < 0) typeIndex = findProperties(&_compute->memoryProperties, typeBits, 0);
+
+	VkImportMemoryHostPointerInfoEXT importInfo;
+	memset(&importInfo, 0, sizeof(VkImportMemoryHostPointerInfoEXT));
+	importInfo.sType = VK_STRUCTURE_TYPE_IMPORT_MEMORY_HOST_POINTER_INFO_EXT;
+	importInfo.handleType = VK_EXTERNAL_MEMORY_HANDLE_TYPE_HOST_ALLOCATION_BIT_EXT;
+	importInfo.pHostPointer = _address;
+
+	VkMemoryAllocateInfo allocInfo;
+	memset(&allocInfo, 0, sizeof(VkMemoryAllocateInfo));
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.pNext = &importInfo;
+	allocInfo.allocationSize = _size;
+	allocInfo.memoryTypeIndex = typeIndex;
+
+	HostMapping mapping = { _address, _size, 0 };
+	if(typeIndex < 0 || vkAllocateMemory(_compute->device, &allocInfo, 0, &mapping.memory) != VK_SUCCESS)
+	{
+		vkDestroyBuffer(_compute->device, *_buffer, 0);
+		return false;
+	}
+
+	vkBindBufferMemory(_compute->device, *_buffer, mapping.memory, 0);
+	_workflow->buffers.push_back(*_buffer);
+	_workflow->hostMappings.push_back(mapping);
+
+	return true;
+}
+
+static bool copyHostFile(Compute *_compute, Workflow *_workflow, int _fd, size_t _size, VkBuffer *_buffer)
+{
+	// Dedicated host visible allocation filled once, no staging pool or AIO involved. Bytes past the end of the file are zeros
+	VkBufferCreateInfo bufferInfo;
+	memset(&bufferInfo, 0, sizeof(VkBufferCreateInfo));
+	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferInfo.size = _size;
+	bufferInfo.usage = accessToBufferUsage(Access_CPU_Write);
+	bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	if(vkCreateBuffer(_compute->device, &bufferInfo, 0, _buffer) != VK_SUCCESS) return false;
+
+	VkMemoryRequirements requirements;
+	vkGetBufferMemoryRequirements(_compute->device, *_buffer, &requirements);
+
+	VkMemoryAllocateInfo allocInfo;
+	memset(&allocInfo, 0, sizeof(VkMemoryAllocateInfo));
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.allocationSize = requirements.size;
+	allocInfo.memoryTypeIndex = findProperties(&_compute->memoryProperties, requirements.memoryTypeBits, 
+											accessToMemoryFlags(Access_CPU_Write));
+
+	HostMapping mapping = { 0, 0, 0 };
+	void *mapped = 0;
+	if(vkAllocateMemory(_compute->device, &allocInfo, 0, &mapping.memory) != VK_SUCCESS)
+	{
+		vkDestroyBuffer(_compute->device, *_buffer, 0);
+		return false;
+	}
+
+	vkMapMemory(_compute->device, mapping.memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+	size_t done = 0;
+	while(_fd >= 0 && done < _size)
+	{
+		ssize_t bytes = pread(_fd, (char *) mapped + done, _size - done, done);
+		if(bytes <= 0) break;
+		done += bytes;
+	}
+	memset((char *) mapped + done, 0, _size - done);
+	vkUnmapMemory(_compute->device, mapping.memory);
+
+	vkBindBufferMemory(_compute->device, *_buffer, mapping.memory, 0);
+	_workflow->buffers.push_back(*_buffer);
+	_workflow->hostMappings.push_back(mapping);
+
+	return true;
+}
+
+static bool createHostFileBuffer(Compute *_compute, Workflow *_workflow, const char *_path, VkDeviceSize _size, 
+	VkBuffer *_buffer, bool *_deviceLocal, const char *_name = "")
+{
+	int fd = open(_path, O_RDONLY);
+	struct stat st;
+	bool complete = fd >= 0 && fstat(fd, &st) == 0 && (VkDeviceSize) st.st_size >= _size;
+	if(!complete) printf("[Error] %s has to hold at least %lu bytes, the missing ones read as zeros\n", _path, (unsigned long) _size);
+
+	// Imports cover whole pages of the page cache, round the mapping to the device alignment
+	size_t page = (size_t) sysconf(_SC_PAGESIZE);
+	size_t alignment = (_compute->hostPointerAlignment > page) ? _compute->hostPointerAlignment : page;
+	size_t size = (_size + alignment - 1) & ~(alignment - 1);
+
+	// Whole pages past the end of the file can't be accessed, those files are copied instead
+	void *address = MAP_FAILED;
+	if(complete && size <= (((size_t) st.st_size + page - 1) & ~(page - 1)))
+		address = mmap(0, size, PROT_READ, MAP_SHARED | MAP_POPULATE, fd, 0);
+
+	*_deviceLocal = false;
+	bool ret = address != MAP_FAILED && importHostFile(_compute, _workflow, address, size, _buffer, _deviceLocal);
+	if(!ret)
+	{
+		if(_compute->hostMemory && complete) printf("[Warning] %s host memory import failed, falling back to a copy\n", _path);
+		*_deviceLocal = false;
+		ret = copyHostFile(_compute, _workflow, fd, _size, _buffer);
+		if(address != MAP_FAILED) munmap(address, size);
+	}
+	if(fd >= 0) close(fd);
+
+	if(ret && DEBUG_MARKERS)
 	{
 		VkDebugUtilsObjectNameInfoEXT nameInfo;
 		memset(&nameInfo, 0, sizeof(VkDebugMarkerObjectNameInfoEXT));
@@ -600,6 +1185,8 @@ static void createBuffer(Compute *_compute, Workflow *_workflow, VkDeviceSize _s
 		nameInfo.pObjectName = _name;
 		vkSetDebugUtilsObjectName(_compute->device, &nameInfo);
 	}
+
+	return ret;
 }
 
 static void transferQueueOwnership(VkCommandBuffer _cmdBuffer, bool _acquire, Access _access, uint32_t _srcIndex, uint32_t _dstIndex, VkBuffer _buffer, VkDeviceSize _size)
@@ -648,8 +1235,71 @@ static void transferQueueOwnership(VkCommandBuffer _cmdBuffer, bool _acquire, Ac
 	}
 }
 
+static void createQueryRing(Compute *_compute, QueryRing *_ring, int _slots, uint32_t _pairs, uint64_t _mask)
+{
+	_ring->slots = (_mask != 0 && _pairs > 0) ? _slots : 0;
+	_ring->pairs = _pairs;
+	_ring->mask = _mask;
+	_ring->samples.assign(_pairs, std::vector<double>());
+
+	VkQueryPoolCreateInfo queryInfo;
+	memset(&queryInfo, 0, sizeof(VkQueryPoolCreateInfo));
+	queryInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryInfo.queryCount = 2 * _pairs;
+	for(int s = 0; s < _ring->slots; ++s)
+	{
+		vkCreateQueryPool(_compute->device, &queryInfo, 0, &_ring->pools[s]);
+		vkResetQueryPool(_compute->device, _ring->pools[s], 0, 2 * _pairs);
+	}
+}
+
+// Both timestamps of a pair are taken once the previous commands are done with the stage, so a pair
+// measures what its command adds on top of them, even when consecutive commands overlap
+static void writeTimestamp(VkCommandBuffer _cmdBuffer, const QueryRing *_ring, int _slot, uint32_t _query, VkPipelineStageFlagBits _stage)
+{
+	if(_slot < _ring->slots && _query < 2 * _ring->pairs) vkCmdWriteTimestamp(_cmdBuffer, _stage, _ring->pools[_slot], _query);
+}
+
+// Pairs the slot hasn't written are still unavailable and skipped, nothing waits on the device
+static void collectQueryRing(Compute *_compute, QueryRing *_ring, int _slot)
+{
+	if(_slot >= _ring->slots) return;
+
+	uint32_t count = 2 * _ring->pairs;
+	std::vector<uint64_t> results(2 * count);
+	VkResult result = vkGetQueryPoolResults(_compute->device, _ring->pools[_slot], 0, count, sizeof(uint64_t) * results.size(), 
+						results.data(), 2 * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+	if(result != VK_SUCCESS && result != VK_NOT_READY) return;
+
+	for(uint32_t p = 0; p < _ring->pairs; ++p)
+	{
+		const uint64_t *begin = &results[4 * p];
+		const uint64_t *end = begin + 2;
+		if(!begin[1] || !end[1]) continue;
+		uint64_t ticks = (end[0] - begin[0]) & _ring->mask;
+		_ring->samples[p].push_back(1.0e-9 * _compute->timestampPeriod * ticks);
+	}
+
+	vkResetQueryPool(_compute->device, _ring->pools[_slot], 0, count);
+}
+
+static void printTimings(const char *_kind, const char *_name, const char *_info, std::vector<double> *_samples)
+{
+	if(_samples->empty()) return;
+
+	std::sort(_samples->begin(), _samples->end());
+	double sum = 0.0;
+	for(double t : *_samples) { sum += t; }
+
+	size_t n = _samples->size();
+	printf("[summary] gpu %s %s%s: mean = %f, p50 = %f, p99 = %f over %zu samples\n", _kind, _name, _info, sum / n,
+		(*_samples)[(size_t) ceil(0.50 * n) - 1], (*_samples)[(size_t) ceil(0.99 * n) - 1], n);
+}
+
 static void createTransferCommand(VkCommandBuffer _transferCmdBuffer, VkBuffer _source, VkBuffer _dest, 
-							VkDeviceSize _size,	const char *_name, float _color[4])
+							VkDeviceSize _size,	const char *_name, float _color[4], 
+							const QueryRing *_queries = 0, int _slot = 0, uint32_t _pair = 0)
 {
 	if(DEBUG_MARKERS)
 	{
@@ -663,7 +1313,9 @@ static void createTransferCommand(VkCommandBuffer _transferCmdBuffer, VkBuffer _
 	copyRegion.srcOffset = 0; // Optional
 	copyRegion.dstOffset = 0; // Optional
 	copyRegion.size = _size;
+	if(_queries) writeTimestamp(_transferCmdBuffer, _queries, _slot, 2 * _pair, VK_PIPELINE_STAGE_TRANSFER_BIT);
 	vkCmdCopyBuffer(_transferCmdBuffer, _source, _dest, 1, &copyRegion);
+	if(_queries) writeTimestamp(_transferCmdBuffer, _queries, _slot, 2 * _pair + 1, VK_PIPELINE_STAGE_TRANSFER_BIT);
 
 	if(DEBUG_MARKERS)
 	{
@@ -678,6 +1330,51 @@ static const char *buildName(char *_dst, const char *_name, const char *_info)
 	return _dst;
 }
 
+static bool overlapData(const Description *_desc, int _a, int _b)
+{
+	// Aliased memory items are the same resource as far as hazards go
+	const Data *a = _desc->dataList + _a;
+	const Data *b = _desc->dataList + _b;
+	if(_a == _b) return true;
+	if(a->source != DataSource_Memory || b->source != DataSource_Memory) return false;
+	return a->poolOffset < b->poolOffset + b->size && b->poolOffset < a->poolOffset + a->size;
+}
+
+static bool hasHazard(const Description *_desc, const unsigned char *_access, const unsigned char *_pending)
+{
+	// Reads after writes, writes after writes and writes after reads, reads after reads need no barrier
+	for(int a = 0; a < _desc->dataCount; ++a)
+		for(int b = 0; _access[a] != SpirvAccess_None && b < _desc->dataCount; ++b)
+		{
+			bool conflict = (_access[a] & SpirvAccess_Write) ? _pending[b] != SpirvAccess_None : (_pending[b] & SpirvAccess_Write) != 0;
+			if(conflict && overlapData(_desc, a, b)) return true;
+		}
+
+	return false;
+}
+
+static void recordComputeBarrier(VkCommandBuffer _cmdBuffer)
+{
+	VkMemoryBarrier barrier;
+	memset(&barrier, 0, sizeof(VkMemoryBarrier));
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	// Aliased memory items are written over what the previous programs wrote
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	if(DEBUG_MARKERS)
+	{
+		VkDebugUtilsLabelEXT labelInfo = { VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT, 
+			0, "Memory Barrier", { 1.0f, 0.0f, 0.0f, 1.0f }};
+		vkCmdBeginDebugUtilsLabel(_cmdBuffer, &labelInfo);
+	}
+
+	vkCmdPipelineBarrier(_cmdBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+
+	if(DEBUG_MARKERS) vkCmdEndDebugUtilsLabel(_cmdBuffer);
+}
+
 static void aioWorkloadCallback(const char *_name, bool _directory, size_t _size, void *_data)
 {
 	AIOWorkload *workload = (AIOWorkload *) _data;
@@ -685,31 +1382,89 @@ static void aioWorkloadCallback(const char *_name, bool _directory, size_t _size
 	{
 		std::string file = workload->path + "/" + _name;
 		workload->files.push_back(file);
+		if(workload->compression != DataCompression_None) workload->sizes.push_back(_size);
 	}
 }
 
-static void createAIOWorkload(std::vector<AIOWorkload> *_aioWorkload, const char *_path, bool _directory,
-						Access _access, VkDeviceSize _offset[2], VkDeviceSize _size, int _iterations)
+static void createAIOWorkload(std::vector<AIOWorkload> *_aioWorkload, const Data *_item, Access _access, 
+						const VkDeviceSize *_offset, int _slots, int _iterations, bool _stream)
 {
+	const char *_path = _item->path;
+	DataSource _source = _item->source;
+
 	AIOWorkload workload;
 	workload.access = _access;
-	workload.offset[0] = _offset[0];
-	workload.offset[1] = _offset[1];
-	workload.size = _size;
+	for(int i = 0; i < _slots; ++i) workload.offset[i] = _offset[i];
+	workload.slots = _slots;
+	workload.size = _item->size;
 	workload.path = _path;
+	workload.pack = 0;
+	workload.sink = 0;
+	workload.scan = 0;
+	workload.compression = _item->compression;
+	workload.capacity = 0;
+	workload.fileOffset = _item->offset;
+	workload.stride = _item->stride;
+	workload.records = 0;
+	workload.format = _item->format;
+	workload.swap = _item->swap;
+	workload.scale = 1.0f;
+	if(_item->normalize && _item->format == ConvertFormat_U8) workload.scale = 1.0f / 255.0f;
+	if(_item->normalize && _item->format == ConvertFormat_U16) workload.scale = 1.0f / 65535.0f;
+
+	// Converted items go through their own packed copy, the file holds that format instead of float32
+	bool converted = _item->format != ConvertFormat_F32 || _item->swap;
+	workload.packedSize = _item->size / sizeof(float) * convertElementSize(_item->format);
+	for(int i = 0; i < MAX_PREFETCH; ++i) workload.packed[i] = 0;
+	for(int i = 0; converted && i < _slots; ++i) workload.packed[i] = (char *) memalign(PACK_ALIGNMENT, workload.packedSize);
+	for(int i = 0; i < MAX_PREFETCH; ++i) workload.compressed[i] = 0;
+
+	// Compressed items are read whole into their own buffer, at most the frame bound of the decoded size
+	bool compressed = _item->compression != DataCompression_None;
+	if(compressed)
+	{
+		workload.capacity = codecBoundLZ4(_item->size);
+		workload.capacity = (workload.capacity + PACK_ALIGNMENT - 1) & ~(PACK_ALIGNMENT - 1);
+		for(int i = 0; i < _slots; ++i) workload.compressed[i] = (char *) memalign(PACK_ALIGNMENT, workload.capacity);
+	}
 
-	if(_directory)
+	if(_source == DataSource_Directory)
 	{
-		if(_access == Access_CPU_Write)
+		if(_access == Access_CPU_Write && _item->manifest)
+		{
+			// Compiled workflows list the directory ahead of time, already sorted
+			const char *name = _item->manifest;
+			for(int i = 0; i < _item->manifestCount; ++i, name += strlen(name) + 1) workload.files.push_back(name);
+		}
+		else if(_access == Access_CPU_Write)
+		{
+			// Streamed scans only enumerate what the execution is about to read
+			workload.scan = aioBeginScan(_path, _item->pattern, _item->recursive, compressed);
+			if(workload.scan == 0) printf("[Error] Directory %s can't be scanned\n", _path);
+			else if(!_stream)
+			{
+				while(aioContinueScan(workload.scan, aioWorkloadCallback, &workload, AIO_SCAN_BATCH) > 0) {}
+				aioEndScan(workload.scan);
+				workload.scan = 0;
+			}
+		}
+		else if(_access == Access_CPU_Read && _item->layout == DataLayout_Pack)
 		{
-			bool ret = aioScanDirectory(_path, aioWorkloadCallback, &workload);
+			// Records land at fixed offsets of a preallocated pack, block aligned for direct I/O
+			std::string file = workload.path + "/output.pack";
+			workload.sink = packCreate(file.c_str(), converted ? workload.packedSize : _item->size, _iterations, PACK_ALIGNMENT);
+			if(workload.sink) workload.files.push_back(file);
 		}
 		else if(_access == Access_CPU_Read)
 		{
+			// Names widen past 4 digits so long runs keep sorting in iteration order
+			int digits = 4;
+			for(int n = _iterations - 1; n >= 10000; n /= 10) ++digits;
+
 			for(int i = 0; i < _iterations; ++i)
 			{
 				char tmp[256];
-				sprintf(tmp, "/output%04d.dat", i);
+				sprintf(tmp, "/output%0*d.dat", digits, i);
 				std::string file = workload.path + tmp;
 				workload.files.push_back(file);
 			}
@@ -717,32 +1472,231 @@ static void createAIOWorkload(std::vector<AIOWorkload> *_aioWorkload, const char
 	}
 	else
 	{
+		// Pack records all come from this single file, read at the offsets of its index
+		if(_source == DataSource_Pack) workload.pack = packOpen(_path);
+
+		// A pack without a valid index has no record to iterate over
 		std::string file = _path;
-		workload.files.push_back(file);
+		if(_source != DataSource_Pack || workload.pack) workload.files.push_back(file);
+
+		struct stat st;
+		if(compressed) workload.sizes.push_back((stat(_path, &st) == 0) ? (size_t) st.st_size : 0);
+
+		// Only whole records are iterated over, converted ones are stored in their packed format
+		size_t record = converted ? workload.packedSize : workload.size;
+		if(workload.stride != 0 && stat(_path, &st) == 0 && (size_t) st.st_size >= workload.fileOffset + record)
+			workload.records = (int) ((st.st_size - workload.fileOffset - record) / workload.stride + 1);
 	}
 
-	std::sort(workload.files.begin(), workload.files.end());
+	if(workload.scan == 0 && !workload.sizes.empty())
+	{
+		// Sizes follow their file through the sort
+		std::vector<std::pair<std::string, size_t>> entries;
+		for(size_t i = 0; i < workload.files.size(); ++i) entries.push_back(std::make_pair(workload.files[i], workload.sizes[i]));
+		std::sort(entries.begin(), entries.end());
+		for(size_t i = 0; i < entries.size(); ++i) { workload.files[i] = entries[i].first; workload.sizes[i] = entries[i].second; }
+	}
+	else if(workload.scan == 0) std::sort(workload.files.begin(), workload.files.end());
 	_aioWorkload->push_back(workload);
 }
 
+static int countAIOWorkload(const AIOWorkload *_workload)
+{
+	if(_workload->stride) return _workload->records;
+	if(_workload->pack) return (int) packGetCount(_workload->pack);
+	if(_workload->sink) return (int) packGetCapacity(_workload->sink);
+	if(_workload->scan) return INT_MAX; // Not known until the scan completes
+	return (int) _workload->files.size();
+}
+
+static int fileAIOWorkload(const AIOWorkload *_workload, int _index)
+{
+	// Packs, output packs and strided files hold every item in their single file
+	return (_workload->pack || _workload->sink || _workload->stride) ? 0 : _index;
+}
+
+static bool extendAIOWorkload(std::vector<AIOWorkload> *_aioWorkload, int _index)
+{
+	// Scan further until every workload holds the item, false once one of them runs out
+	bool ret = true;
+	for(AIOWorkload &workload : *_aioWorkload)
+	{
+		while(workload.scan && (int) workload.files.size() <= _index)
+		{
+			if(aioContinueScan(workload.scan, aioWorkloadCallback, &workload, AIO_SCAN_BATCH) == 0)
+			{
+				aioEndScan(workload.scan);
+				workload.scan = 0;
+			}
+		}
+		ret = ret && _index < countAIOWorkload(&workload);
+	}
+
+	return ret;
+}
+
 static void createAIOCommands(Workflow *_workflow, AIOCmdBuffer *_aioCmdBuffer, const std::vector<AIOWorkload> *_aioWorkload, 
 							Access _access, int _index)
 {
-	int lsb = _index & 0x1;
 	for(const AIOWorkload &workload : *_aioWorkload)
 	{
 		if(workload.access == _access)
 		{
-			void *buffer = _workflow->memory[_access].mapped + workload.offset[lsb];
-			if(_access == Access_CPU_Write) 
-				aioCmdRead(_aioCmdBuffer, buffer, workload.files[_index].c_str(), workload.size);
+			// Converted items are transferred in their packed copy
+			int slot = _index % workload.slots;
+			void *buffer = _workflow->memory[_access].mapped + workload.offset[slot];
+			size_t fileSize = workload.size;
+			if(workload.packed[slot]) { buffer = workload.packed[slot]; fileSize = workload.packedSize; }
+
+			if(workload.pack)
+			{
+				// Shorter records leave no stale data from the previous one behind
+				const PackRecord *record = packGetRecord(workload.pack, _index);
+				size_t size = (record->size < fileSize) ? record->size : fileSize;
+				if(size < fileSize) memset((char *) buffer + size, 0, fileSize - size);
+				aioCmdRead(_aioCmdBuffer, buffer, workload.files[0].c_str(), size, record->offset);
+			}
+			else if(workload.sink)
+				aioCmdWrite(_aioCmdBuffer, buffer, workload.files[0].c_str(), fileSize, packGetOffset(workload.sink, _index));
+			else if(workload.compression != DataCompression_None)
+			{
+				// The workers decode it into the staging slot once the read completes
+				size_t size = std::min(workload.sizes[_index], workload.capacity);
+				aioCmdRead(_aioCmdBuffer, workload.compressed[_index % workload.slots], workload.files[_index].c_str(), size);
+			}
+			else if(_access == Access_CPU_Write) 
+			{
+				// Items sharing a file are recorded back to back, the AIO layer merges the contiguous ones
+				size_t offset = workload.fileOffset + (size_t) _index * workload.stride;
+				aioCmdRead(_aioCmdBuffer, buffer, workload.files[fileAIOWorkload(&workload, _index)].c_str(), fileSize, offset);
+			}
 			else
-				aioCmdWrite(_aioCmdBuffer, buffer, workload.files[_index].c_str(), workload.size);
+				aioCmdWrite(_aioCmdBuffer, buffer, workload.files[_index].c_str(), fileSize);
 		}
 	}
 }
 
-int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Description *_desc)
+static bool checkAIOCommands(const AIOCmdBuffer *_aioCmdBuffer, const std::vector<AIOWorkload> *_aioWorkload, 
+							Access _access, int _index, std::vector<double> *_latencies)
+{
+	// Results follow the recording order of createAIOCommands
+	bool ret = true;
+	int command = 0;
+	for(const AIOWorkload &workload : *_aioWorkload)
+	{
+		if(workload.access != _access) continue;
+
+		const AIOResult *result = aioGetResult(_aioCmdBuffer, command++);
+		if(result == 0) continue;
+
+		if(result->error != 0 || result->bytes < result->requested)
+		{
+			const char *file = workload.files[fileAIOWorkload(&workload, _index)].c_str();
+			printf("[Warning] AIO %s %s[%d]: %zu of %zu bytes (%s)\n", (_access == Access_CPU_Write) ? "read" : "write",
+				file, _index, result->bytes, result->requested, (result->error != 0) ? strerror(result->error) : "end of file");
+			ret = false;
+		}
+		_latencies->push_back(result->latency);
+	}
+
+	return ret;
+}
+
+static void decodeTask(void *_data)
+{
+	DecodeJob *job = (DecodeJob *) _data;
+	size_t written = 0;
+	job->ok = codecDecompressLZ4(job->src, job->srcSize, job->dst, job->dstSize, &written);
+
+	// Shorter items leave no stale data from the previous one behind
+	if(written < job->dstSize) memset(job->dst + written, 0, job->dstSize - written);
+}
+
+static void decodeAIOWorkload(TaskPool *_pool, TaskGroup *_group, Workflow *_workflow, std::vector<AIOWorkload> *_aioWorkload, int _index)
+{
+	for(AIOWorkload &workload : *_aioWorkload)
+	{
+		if(workload.compression == DataCompression_None) continue;
+
+		int slot = _index % workload.slots;
+		DecodeJob *job = workload.jobs + slot;
+		job->src = workload.compressed[slot];
+		job->srcSize = std::min(workload.sizes[_index], workload.capacity);
+		job->dst = _workflow->memory[Access_CPU_Write].mapped + workload.offset[slot];
+		job->dstSize = workload.size;
+		job->ok = false;
+
+		if(_pool) taskSubmit(_pool, _group, decodeTask, job);
+		else decodeTask(job);
+	}
+}
+
+static bool waitAIODecodes(TaskPool *_pool, TaskGroup *_group, const std::vector<AIOWorkload> *_aioWorkload, int _index)
+{
+	if(_pool) taskWait(_pool, _group);
+
+	bool ret = true;
+	for(const AIOWorkload &workload : *_aioWorkload)
+	{
+		if(workload.compression == DataCompression_None || workload.jobs[_index % workload.slots].ok) continue;
+
+		printf("[Warning] LZ4 %s[%d] is not a valid frame of at most %zu bytes\n", 
+			workload.files[_index].c_str(), _index, (size_t) workload.size);
+		ret = false;
+	}
+
+	return ret;
+}
+
+static void convertAIOWorkload(Workflow *_workflow, const std::vector<AIOWorkload> *_aioWorkload, Access _access, int _index)
+{
+	// Inputs expand into the staging slot after their read, outputs pack out of it before their write
+	for(const AIOWorkload &workload : *_aioWorkload)
+	{
+		int slot = _index % workload.slots;
+		if(workload.access != _access || workload.packed[slot] == 0) continue;
+
+		float *staging = (float *) (_workflow->memory[_access].mapped + workload.offset[slot]);
+		size_t count = workload.size / sizeof(float);
+		if(_access == Access_CPU_Write) convertToFloat(staging, workload.packed[slot], count, workload.format, workload.swap, workload.scale);
+		else convertFromFloat(workload.packed[slot], staging, count, workload.format, workload.swap, workload.scale);
+	}
+}
+
+static void openAIOFiles(AIO *_aio, const std::vector<AIOWorkload> *_aioWorkload, Access _access, int _index, bool _persistent)
+{
+	AIOFileMode mode = (_access == Access_CPU_Write) ? AIOFileMode_Read : AIOFileMode_Write;
+	for(const AIOWorkload &workload : *_aioWorkload)
+	{
+		if(workload.access != _access) continue;
+
+		// A pack or strided file is a single file kept open for the whole run, an output pack is already preallocated
+		if(workload.pack || workload.stride) aioOpenFile(_aio, workload.files[0].c_str(), mode, true);
+		else if(workload.sink) aioOpenFile(_aio, workload.files[0].c_str(), mode, true, false);
+		else if(_index < (int) workload.files.size()) aioOpenFile(_aio, workload.files[_index].c_str(), mode, _persistent);
+	}
+}
+
+static void adviseAIOFiles(AIO *_aio, const std::vector<AIOWorkload> *_aioWorkload, int _index)
+{
+	for(const AIOWorkload &workload : *_aioWorkload)
+	{
+		if(workload.access != Access_CPU_Write) continue;
+
+		if(workload.pack)
+		{
+			const PackRecord *record = packGetRecord(workload.pack, _index);
+			if(record) aioAdvise(_aio, workload.files[0].c_str(), record->size, record->offset);
+		}
+		else if(_index < (workload.stride ? workload.records : (int) workload.files.size()))
+		{
+			size_t offset = workload.fileOffset + (size_t) _index * workload.stride;
+			aioAdvise(_aio, workload.files[fileAIOWorkload(&workload, _index)].c_str(), workload.size, offset);
+		}
+	}
+}
+
+static int createWorkflowResources(Compute *_compute, Workflow *_workflow, const Description *_desc, TaskPool *_pool)
 {
 	int iterations = -1;
 
@@ -752,14 +1706,18 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 	// Allocate command buffers
 	allocateCommandBuffers(_compute, _compute->graphicsCommandPool, 2, _workflow->graphicsCmdBuffers);
 	allocateCommandBuffers(_compute, _compute->graphicsCommandPool, 2, _workflow->graphicsQFOTCmdBuffers);
-	allocateCommandBuffers(_compute, _compute->transferCommandPool, 2, _workflow->transferCmdBuffers);
+	_workflow->prefetch = _desc->parameters.prefetch;
+	allocateCommandBuffers(_compute, _compute->transferCommandPool, _workflow->prefetch, _workflow->transferCmdBuffers);
 	allocateCommandBuffers(_compute, _compute->transferCommandPool, 2, _workflow->transferUniqueCmdBuffers);
 	allocateCommandBuffers(_compute, _compute->computeCommandPool, 2, _workflow->computeCmdBuffers);
 
-	VkDescriptorBufferInfo bufferInfos[2][256];
-	VkWriteDescriptorSet descriptorWrites[2][256];
-	memset(descriptorWrites, 0, sizeof(descriptorWrites));
-	VkDescriptorSetLayoutBinding descriptorBindings[256];
+	// GPU timings of every program and every streamed copy, with a query pool per command buffer of each ring
+	createQueryRing(_compute, &_workflow->graphicsQueries, 2, _desc->programCount, _compute->timestampMasks[0]);
+	createQueryRing(_compute, &_workflow->transferQueries, _workflow->prefetch, _desc->dataCount, _compute->timestampMasks[1]);
+	_workflow->transferItems.clear();
+
+	VkDescriptorBufferInfo (*bufferInfos)[MAX_BINDINGS] = _workflow->bufferInfos;
+	VkDescriptorSetLayoutBinding descriptorBindings[MAX_BINDINGS];
 	memset(descriptorBindings, 0, sizeof(descriptorBindings));
 	// {0, VK_DESCRIPTOR_TYPE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0}, //samplerPoint
 	// {11, VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0}, //dataIn
@@ -769,6 +1727,38 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 	// {31, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0}, //Constants2
 	// {40, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, 0} //hdrOut
 
+	// Each program gets a layout of the bindings it uses. Pipelines only depend on those layouts,
+	// they compile on the pool while the buffers are created and the directories scanned
+	_workflow->pipelineJobs.resize(_desc->programCount);
+	_workflow->pipelineGroup.pending = 0;
+	for(int p = 0; p < _desc->programCount; ++p)
+	{
+		const Program *item = _desc->programList + p;
+
+		int bindingCount = 0;
+		for(int b = 0; b < _desc->dataCount; ++b)
+		{
+			if(item->access[b] == SpirvAccess_None) continue;
+
+			VkDescriptorSetLayoutBinding *binding = descriptorBindings + bindingCount;
+			binding->binding = b;
+			binding->descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			binding->descriptorCount = 1;
+			binding->stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+			binding->pImmutableSamplers = 0;
+			++bindingCount;
+		}
+
+		PipelineJob *job = &_workflow->pipelineJobs[p];
+		job->compute = _compute;
+		job->program = item;
+		createDescriptorLayout(_compute, _workflow, descriptorBindings, bindingCount, &job->descriptorLayout);
+		createPipelineLayout(_compute, _workflow, &job->descriptorLayout, sizeof(uint32_t) * item->pushCount, &job->pipelineLayout);
+
+		if(_pool) taskSubmit(_pool, &_workflow->pipelineGroup, pipelineTask, job);
+		else pipelineTask(job);
+	}
+
 
 	// ------------- Iterate over JSON data ----------------------------------------------------------------
 
@@ -777,8 +1767,8 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = 0; //VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 	beginInfo.pInheritanceInfo = 0; // Optional
-	vkBeginCommandBuffer(_workflow->transferCmdBuffers[0], &beginInfo);
-	vkBeginCommandBuffer(_workflow->transferCmdBuffers[1], &beginInfo);
+	for(int t = 0; t < _workflow->prefetch; ++t)
+		vkBeginCommandBuffer(_workflow->transferCmdBuffers[t], &beginInfo);
 	vkBeginCommandBuffer(_workflow->transferUniqueCmdBuffers[0], &beginInfo);
 	vkBeginCommandBuffer(_workflow->transferUniqueCmdBuffers[1], &beginInfo);
 
@@ -786,8 +1776,8 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 	{
 		VkDebugUtilsLabelEXT labelInfo = { VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT, 
 			0, "Transfer Cmds", { 0.7f, 0.7f, 0.7f, 1.0f }};
-		vkCmdBeginDebugUtilsLabel(_workflow->transferCmdBuffers[0], &labelInfo);
-		vkCmdBeginDebugUtilsLabel(_workflow->transferCmdBuffers[1], &labelInfo);
+		for(int t = 0; t < _workflow->prefetch; ++t)
+			vkCmdBeginDebugUtilsLabel(_workflow->transferCmdBuffers[t], &labelInfo);
 
 		VkDebugUtilsLabelEXT labelInfo2 = { VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT, 
 			0, "Transfer Unique Cmds", { 0.6f, 0.6f, 0.6f, 1.0f }};
@@ -803,20 +1793,57 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 		char debugName[128];
 		const Data *item = _desc->dataList + i;
 
+		// Items no program uses are left out of every layout and get no buffer, only those driving the iterations are still streamed
+		bool iterated = item->source == DataSource_Directory || item->source == DataSource_Pack || 
+						(item->source == DataSource_File && item->stride != 0);
+		if(item->usage == SpirvAccess_None && !iterated) continue;
+
 		if(item->source == DataSource_Memory)
 		{
+			// Placed by the description, items with disjoint lifetimes share the same range
 			VkBuffer buffer;
-			VkDeviceSize offset;
-			createBuffer(_compute, _workflow, item->size, Access_GPU_ReadWrite, &buffer, &offset, 
+			VkDeviceSize offset = item->poolOffset / SAFE_ALIGNMENT * _workflow->memory[Access_GPU_ReadWrite].alignment;
+			createPlacedBuffer(_compute, _workflow, item->size, Access_GPU_ReadWrite, offset, &buffer, 
 							buildName(debugName, item->name, "_GPU_ReadWrite"));
 
 			bufferInfos[0][i].buffer = bufferInfos[1][i].buffer = buffer;
 			bufferInfos[0][i].offset = bufferInfos[1][i].offset = 0;
 			bufferInfos[0][i].range = bufferInfos[1][i].range = item->size;
 		}
-		else if(item->source == DataSource_File)
+		else if(item->source == DataSource_File && item->stride == 0)
 		{
-			if(item->access == DataAccess_Read)
+			bool mappable = item->compression == DataCompression_None && item->offset == 0 && item->format == ConvertFormat_F32 && !item->swap;
+			if(item->access == DataAccess_Read && _desc->parameters.mmap && mappable)
+			{
+				// The mapped file replaces the staging copy, UMA devices even bind it as is
+				VkBuffer hbuffer;
+				bool deviceLocal = false;
+				bool mapped = createHostFileBuffer(_compute, _workflow, item->path, item->size, &hbuffer, &deviceLocal, 
+								buildName(debugName, item->name, "_Host"));
+
+				VkBuffer buffer = hbuffer;
+				if(!deviceLocal)
+				{
+					VkDeviceSize offset;
+					createBuffer(_compute, _workflow, item->size, Access_GPU_Read, &buffer, &offset, 
+									buildName(debugName, item->name, "_GPU_Read"));
+
+					float color[4] = { 1.0f, 0.4f, 0.4f, 1.0f };
+					if(mapped) createTransferCommand(_workflow->transferUniqueCmdBuffers[0], hbuffer, buffer, item->size, item->name, color);
+				}
+
+				// Without a host buffer the item reads as zeros, like the missing part of a short file
+				if(!mapped)
+				{
+					printf("[Error] data[%d] has no host buffer for %s, it reads as zeros\n", i, item->path);
+					vkCmdFillBuffer(_workflow->transferUniqueCmdBuffers[0], buffer, 0, VK_WHOLE_SIZE, 0);
+				}
+
+				bufferInfos[0][i].buffer = bufferInfos[1][i].buffer = buffer;
+				bufferInfos[0][i].offset = bufferInfos[1][i].offset = 0;
+				bufferInfos[0][i].range = bufferInfos[1][i].range = item->size;
+			}
+			else if(item->access == DataAccess_Read)
 			{
 				VkBuffer sbuffer;
 				VkDeviceSize offsets[2];
@@ -824,7 +1851,7 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 								buildName(debugName, item->name, "_CPU_Write"));
 
 				offsets[1] = offsets[0];
-				createAIOWorkload(&_workflow->aioUniqueWorkload, item->path, false, Access_CPU_Write, offsets, item->size, iterations);
+				createAIOWorkload(&_workflow->aioUniqueWorkload, item, Access_CPU_Write, offsets, 1, iterations, _desc->parameters.stream);
 			
 				VkBuffer buffer;
 				VkDeviceSize offset;
@@ -846,7 +1873,7 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 								buildName(debugName, item->name, "_CPU_Read"));
 
 				offsets[1] = offsets[0];
-				createAIOWorkload(&_workflow->aioUniqueWorkload, item->path, false, Access_CPU_Read, offsets, item->size, iterations);
+				createAIOWorkload(&_workflow->aioUniqueWorkload, item, Access_CPU_Read, offsets, 1, iterations, _desc->parameters.stream);
 
 				VkBuffer buffer;
 				VkDeviceSize offset;
@@ -861,17 +1888,21 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 				bufferInfos[0][i].range = bufferInfos[1][i].range = item->size;
 			}
 		}
-		else if(item->source == DataSource_Directory)
+		else if(item->source == DataSource_Directory || item->source == DataSource_Pack || (item->source == DataSource_File && item->stride != 0))
 		{
+			int prefetch = _workflow->prefetch;
 			if(item->access == DataAccess_Read)
 			{
-				VkBuffer sbuffer[2];
-				VkDeviceSize offsets[2];
-				createBuffer(_compute, _workflow, item->size, Access_CPU_Write, &sbuffer[0], &offsets[0], 
-								buildName(debugName, item->name, "_CPU_Write_0"));
-				createBuffer(_compute, _workflow, item->size, Access_CPU_Write, &sbuffer[1], &offsets[1], 
-								buildName(debugName, item->name, "_CPU_Write_1"));
-				createAIOWorkload(&_workflow->aioWorkload, item->path, true, Access_CPU_Write, offsets, item->size, iterations);
+				VkBuffer sbuffer[MAX_PREFETCH];
+				VkDeviceSize offsets[MAX_PREFETCH];
+				for(int s = 0; s < prefetch; ++s)
+				{
+					char suffix[32];
+					sprintf(suffix, "_CPU_Write_%d", s);
+					createBuffer(_compute, _workflow, item->size, Access_CPU_Write, &sbuffer[s], &offsets[s], 
+									buildName(debugName, item->name, suffix));
+				}
+				createAIOWorkload(&_workflow->aioWorkload, item, Access_CPU_Write, offsets, prefetch, iterations, _desc->parameters.stream);
 			
 				VkBuffer buffer[2];
 				createBuffer(_compute, _workflow, item->size, Access_GPU_Read, &buffer[0], &offsets[0], 
@@ -879,14 +1910,18 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 				createBuffer(_compute, _workflow, item->size, Access_GPU_Read, &buffer[1], &offsets[1],
 								buildName(debugName, item->name, "_GPU_Read_1"));
 
+				// Iteration t uploads the next item, staged in ring slot t+1 and consumed from GPU slot (t+1)&1
 				float color[4] = { 1.0f, 0.4f, 0.4f, 1.0f };
-				createTransferCommand(_workflow->transferCmdBuffers[0], sbuffer[1], buffer[1], item->size, item->name, color);
-				//transferQueueOwnership(_workflow->transferCmdBuffers[0], false, Access_GPU_Read, _compute->transferIndex, _compute->graphicsIndex, buffer[1], item->size);
-				//transferQueueOwnership(_workflow->graphicsCmdBuffers[0], true, Access_GPU_Read, _compute->transferIndex, _compute->graphicsIndex, buffer[1], item->size);
-
-				createTransferCommand(_workflow->transferCmdBuffers[1], sbuffer[0], buffer[0], item->size, item->name, color);
-				//transferQueueOwnership(_workflow->transferCmdBuffers[1], false, Access_GPU_Read, _compute->transferIndex, _compute->graphicsIndex, buffer[0], item->size);
-				//transferQueueOwnership(_workflow->graphicsCmdBuffers[1], true, Access_GPU_Read, _compute->transferIndex, _compute->graphicsIndex, buffer[0], item->size);
+				uint32_t pair = _workflow->transferItems.size();
+				_workflow->transferItems.push_back(i);
+				for(int t = 0; t < prefetch; ++t)
+				{
+					int s = (t + 1) % prefetch;
+					createTransferCommand(_workflow->transferCmdBuffers[t], sbuffer[s], buffer[s & 0x1], item->size, item->name, color,
+										&_workflow->transferQueries, t, pair);
+					//transferQueueOwnership(_workflow->transferCmdBuffers[t], false, Access_GPU_Read, _compute->transferIndex, _compute->graphicsIndex, buffer[s & 0x1], item->size);
+					//transferQueueOwnership(_workflow->graphicsCmdBuffers[s & 0x1], true, Access_GPU_Read, _compute->transferIndex, _compute->graphicsIndex, buffer[s & 0x1], item->size);
+				}
 
 				bufferInfos[0][i].buffer = buffer[0]; bufferInfos[1][i].buffer = buffer[1];
 				bufferInfos[0][i].offset = bufferInfos[1][i].offset = 0;
@@ -894,13 +1929,16 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 			}
 			else if(item->access == DataAccess_Write)
 			{
-				VkBuffer sbuffer[2];
-				VkDeviceSize offsets[2];
-				createBuffer(_compute, _workflow, item->size, Access_CPU_Read, &sbuffer[0], &offsets[0], 
-								buildName(debugName, item->name, "_CPU_Read_0"));
-				createBuffer(_compute, _workflow, item->size, Access_CPU_Read, &sbuffer[1], &offsets[1], 
-								buildName(debugName, item->name, "_CPU_Read_1"));
-				createAIOWorkload(&_workflow->aioWorkload, item->path, true, Access_CPU_Read, offsets, item->size, iterations);
+				VkBuffer sbuffer[MAX_PREFETCH];
+				VkDeviceSize offsets[MAX_PREFETCH];
+				for(int s = 0; s < prefetch; ++s)
+				{
+					char suffix[32];
+					sprintf(suffix, "_CPU_Read_%d", s);
+					createBuffer(_compute, _workflow, item->size, Access_CPU_Read, &sbuffer[s], &offsets[s], 
+									buildName(debugName, item->name, suffix));
+				}
+				createAIOWorkload(&_workflow->aioWorkload, item, Access_CPU_Read, offsets, prefetch, iterations, _desc->parameters.stream);
 
 				VkBuffer buffer[2];
 				createBuffer(_compute, _workflow, item->size, Access_GPU_Write, &buffer[0], &offsets[0],
@@ -908,166 +1946,251 @@ int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Descript
 				createBuffer(_compute, _workflow, item->size, Access_GPU_Write, &buffer[1], &offsets[1], 
 								buildName(debugName, item->name, "_GPU_Write_1"));
 			
+				// Iteration t downloads the previous item from GPU slot (t+1)&1 into ring slot t-1
 				float color[4] = { 0.4f, 0.4f, 1.0f, 1.0f };
-				createTransferCommand(_workflow->transferCmdBuffers[0], buffer[1], sbuffer[1], item->size, item->name, color);
-				createTransferCommand(_workflow->transferCmdBuffers[1], buffer[0], sbuffer[0], item->size, item->name, color);
+				uint32_t pair = _workflow->transferItems.size();
+				_workflow->transferItems.push_back(i);
+				for(int t = 0; t < prefetch; ++t)
+				{
+					int s = (t + prefetch - 1) % prefetch;
+					createTransferCommand(_workflow->transferCmdBuffers[t], buffer[s & 0x1], sbuffer[s], item->size, item->name, color,
+										&_workflow->transferQueries, t, pair);
+				}
 				
 				bufferInfos[0][i].buffer = buffer[0]; bufferInfos[1][i].buffer = buffer[1];
 				bufferInfos[0][i].offset = bufferInfos[1][i].offset = 0;
 				bufferInfos[0][i].range = bufferInfos[1][i].range = item-> size;
 			}
 		}
-
-		descriptorBindings[i].binding = i;
-		descriptorBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		descriptorBindings[i].descriptorCount = 1;
-		descriptorBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
-		descriptorBindings[i].pImmutableSamplers = 0;
-
-		descriptorWrites[0][i].sType = descriptorWrites[1][i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-		descriptorWrites[0][i].dstSet = descriptorWrites[1][i].dstSet = 0; // Fill later
-		descriptorWrites[0][i].dstBinding = descriptorWrites[1][i].dstBinding = i;
-		descriptorWrites[0][i].dstArrayElement = descriptorWrites[1][i].dstArrayElement = 0;
-		descriptorWrites[0][i].descriptorType = descriptorWrites[1][i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-		descriptorWrites[0][i].descriptorCount = descriptorWrites[1][i].descriptorCount = 1;
-		descriptorWrites[0][i].pBufferInfo = &bufferInfos[0][i]; descriptorWrites[1][i].pBufferInfo = &bufferInfos[1][i];
 	}
 
 	if(DEBUG_MARKERS)
 	{
-		vkCmdEndDebugUtilsLabel(_workflow->transferCmdBuffers[0]);
-		vkCmdEndDebugUtilsLabel(_workflow->transferCmdBuffers[1]);
+		for(int t = 0; t < _workflow->prefetch; ++t)
+			vkCmdEndDebugUtilsLabel(_workflow->transferCmdBuffers[t]);
 		vkCmdEndDebugUtilsLabel(_workflow->transferUniqueCmdBuffers[0]);
 		vkCmdEndDebugUtilsLabel(_workflow->transferUniqueCmdBuffers[1]);
 	}
 
-	vkEndCommandBuffer(_workflow->transferCmdBuffers[0]);
-	vkEndCommandBuffer(_workflow->transferCmdBuffers[1]);
+	for(int t = 0; t < _workflow->prefetch; ++t)
+		vkEndCommandBuffer(_workflow->transferCmdBuffers[t]);
 	vkEndCommandBuffer(_workflow->transferUniqueCmdBuffers[0]);
 	vkEndCommandBuffer(_workflow->transferUniqueCmdBuffers[1]);
 
-	VkDescriptorSetLayout descriptorLayout;
-	createDescriptorLayout(_compute, _workflow, descriptorBindings, count, &descriptorLayout);
+	// Update iterations according to AIO workload count
+	for(const AIOWorkload &workload : _workflow->aioWorkload)
+	{
+		int filecount = countAIOWorkload(&workload);
+		iterations = (filecount < iterations) ? filecount : iterations;
+	}
 
-	VkDescriptorSetAllocateInfo allocInfo;
-	memset(&allocInfo, 0, sizeof(VkDescriptorSetAllocateInfo));
-	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-	allocInfo.descriptorPool = _compute->descriptorPool;
-	allocInfo.descriptorSetCount = 1;
-	allocInfo.pSetLayouts = &descriptorLayout;
-	vkAllocateDescriptorSets(_compute->device, &allocInfo, &_workflow->computeDescriptors[0]);
-	vkAllocateDescriptorSets(_compute->device, &allocInfo, &_workflow->computeDescriptors[1]);
+	return iterations;
+}
 
-	for(int i = 0; i < count; ++i)
+static void recordPushConstants(VkCommandBuffer _cmdBuffer, VkPipelineLayout _pipelineLayout, const Program *_program, const PushState *_push)
+{
+	uint32_t words[MAX_PUSH_WORDS];
+	for(int w = 0; w < _program->pushCount; ++w)
 	{
-		descriptorWrites[0][i].dstSet = _workflow->computeDescriptors[0];
-		descriptorWrites[1][i].dstSet = _workflow->computeDescriptors[1];
+		const PushConstant *constant = _program->push + w;
+		switch(constant->builtin)
+		{
+			case PushBuiltin_Iteration: words[w] = _push->iteration; break;
+			case PushBuiltin_Iterations: words[w] = _push->iterations; break;
+			case PushBuiltin_Slot: words[w] = _push->slot; break;
+			case PushBuiltin_Ring: words[w] = _push->ring; break;
+			default: words[w] = constant->value; break;
+		}
 	}
-	vkUpdateDescriptorSets(_compute->device, count, descriptorWrites[0], 0, 0);
-	vkUpdateDescriptorSets(_compute->device, count, descriptorWrites[1], 0, 0);
 
-	VkPipelineLayout pipelineLayout;
-	createPipelineLayout(_compute, _workflow, &descriptorLayout, &pipelineLayout);
+	vkCmdPushConstants(_cmdBuffer, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(uint32_t) * _program->pushCount, words);
+}
 
-	// ------- Iterate over JSON program -------------------------------------------------------------
+// Records the programs of one GPU slot with the push constants of _workflow->push
+static void recordGraphicsCmdBuffer(Workflow *_workflow, const Description *_desc, int _slot)
+{
+	VkCommandBuffer cmdBuffer = _workflow->graphicsCmdBuffers[_slot];
 
+	VkCommandBufferBeginInfo beginInfo;
 	memset(&beginInfo, 0, sizeof(VkCommandBufferBeginInfo));
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	//beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 	beginInfo.pInheritanceInfo = 0; // Optional
-	
-	vkBeginCommandBuffer(_workflow->graphicsCmdBuffers[0], &beginInfo);
-	vkBeginCommandBuffer(_workflow->graphicsCmdBuffers[1], &beginInfo);
+	vkBeginCommandBuffer(cmdBuffer, &beginInfo);
 
 	if(DEBUG_MARKERS)
 	{
 		VkDebugUtilsLabelEXT labelInfo = { VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT, 
 			0, "Graphics Cmds", { 0.4f, 1.0f, 0.4f, 1.0f }};
-		vkCmdBeginDebugUtilsLabel(_workflow->graphicsCmdBuffers[0], &labelInfo);
-		vkCmdBeginDebugUtilsLabel(_workflow->graphicsCmdBuffers[1], &labelInfo);
+		vkCmdBeginDebugUtilsLabel(cmdBuffer, &labelInfo);
 	}
 
-	count = _desc->programCount;
+	// Reads and writes recorded since the last barrier, a program only waits when it touches one of them
+	unsigned char pending[MAX_BINDINGS];
+	memset(pending, 0, sizeof(pending));
+
+	int count = _desc->programCount;
 	for(int i = 0; i < count; ++i)
 	{
 		const Program *item = _desc->programList + i;
+		const PipelineJob *job = &_workflow->pipelineJobs[i];
 
-		VkShaderModule module;
-		createShaderModule(_compute, _workflow, item->path, &module, item->path);
+		vkCmdBindPipeline(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, job->pipeline);
+		vkCmdBindDescriptorSets(cmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, 
+			job->pipelineLayout, 0, 1, &job->descriptorSets[_slot], 0, 0);
+		if(item->pushCount > 0) recordPushConstants(cmdBuffer, job->pipelineLayout, item, &_workflow->push);
 
-		VkPipeline pipeline;
-		createComputePipeline(_compute, _workflow, &module, &pipelineLayout, &pipeline);
-
-		vkCmdBindPipeline(_workflow->graphicsCmdBuffers[0], VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
-		vkCmdBindPipeline(_workflow->graphicsCmdBuffers[1], VK_PIPELINE_BIND_POINT_COMPUTE, pipeline);
-
-		vkCmdBindDescriptorSets(_workflow->graphicsCmdBuffers[0], VK_PIPELINE_BIND_POINT_COMPUTE, 
-			pipelineLayout, 0, 1, &_workflow->computeDescriptors[0], 0, 0);
-		vkCmdBindDescriptorSets(_workflow->graphicsCmdBuffers[1], VK_PIPELINE_BIND_POINT_COMPUTE, 
-			pipelineLayout, 0, 1, &_workflow->computeDescriptors[1], 0, 0);
+		if(hasHazard(_desc, item->access, pending))
+		{
+			recordComputeBarrier(cmdBuffer);
+			memset(pending, 0, sizeof(pending));
+		}
 
 		if(DEBUG_MARKERS)
 		{
 			VkDebugUtilsLabelEXT labelInfo = { VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT, 
 				0, item->name, { 1.0f, 1.0f, 0.4f, 1.0f }};
-			vkCmdBeginDebugUtilsLabel(_workflow->graphicsCmdBuffers[0], &labelInfo);
-			vkCmdBeginDebugUtilsLabel(_workflow->graphicsCmdBuffers[1], &labelInfo);
+			vkCmdBeginDebugUtilsLabel(cmdBuffer, &labelInfo);
 		}
 
-		vkCmdDispatch(_workflow->graphicsCmdBuffers[0], item->dispatch[0], item->dispatch[1], item->dispatch[2]);
-		vkCmdDispatch(_workflow->graphicsCmdBuffers[1], item->dispatch[0], item->dispatch[1], item->dispatch[2]);
+		writeTimestamp(cmdBuffer, &_workflow->graphicsQueries, _slot, 2 * i, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+		vkCmdDispatch(cmdBuffer, item->dispatch[0], item->dispatch[1], item->dispatch[2]);
+		writeTimestamp(cmdBuffer, &_workflow->graphicsQueries, _slot, 2 * i + 1, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
 
-		if(DEBUG_MARKERS)
-		{
-			vkCmdEndDebugUtilsLabel(_workflow->graphicsCmdBuffers[0]);
-			vkCmdEndDebugUtilsLabel(_workflow->graphicsCmdBuffers[1]);
-		}
+		if(DEBUG_MARKERS) vkCmdEndDebugUtilsLabel(cmdBuffer);
+
+		for(int b = 0; b < _desc->dataCount; ++b) pending[b] |= item->access[b];
+	}
 
-		VkMemoryBarrier barrier;
-		memset(&barrier, 0, sizeof(VkMemoryBarrier));
-		barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
-		barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	// The next iteration and the downloads are still ordered after the last programs
+	if(count > 0) recordComputeBarrier(cmdBuffer);
 
-		if(DEBUG_MARKERS)
+	if(DEBUG_MARKERS) vkCmdEndDebugUtilsLabel(cmdBuffer);
+
+	vkEndCommandBuffer(cmdBuffer);
+}
+
+static void recordWorkflowPrograms(Compute *_compute, Workflow *_workflow, const Description *_desc, TaskPool *_pool, int _iterations)
+{
+	VkDescriptorBufferInfo (*bufferInfos)[MAX_BINDINGS] = _workflow->bufferInfos;
+	VkWriteDescriptorSet descriptorWrites[2][MAX_BINDINGS];
+	memset(descriptorWrites, 0, sizeof(descriptorWrites));
+
+	// A pair of descriptor sets per program for both GPU slots
+	int count = _desc->dataCount;
+	int descriptorCount = 0;
+	for(int p = 0; p < _desc->programCount; ++p)
+		for(int i = 0; i < count; ++i) descriptorCount += (_desc->programList[p].access[i] != SpirvAccess_None) ? 1 : 0;
+	createDescriptorPool(_compute, _workflow, 2 * _desc->programCount, 2 * descriptorCount);
+
+	// Compiled pipelines are only handed over to the workflow here, once no worker touches them anymore
+	if(_pool) taskWait(_pool, &_workflow->pipelineGroup);
+	for(const PipelineJob &job : _workflow->pipelineJobs)
+	{
+		_workflow->pipelines.push_back(job.pipeline);
+		if(job.module != VK_NULL_HANDLE) _workflow->shaderModules.push_back(job.module);
+		if(job.identifier.size > 0 && !findShaderIdentifier(_compute, job.identifier.hash, job.identifier.codeSize))
+			_compute->identifiers.push_back(job.identifier);
+	}
+
+	// ------- Iterate over JSON program -------------------------------------------------------------
+
+	_workflow->dynamicPush = false;
+	count = _desc->programCount;
+	for(int i = 0; i < count; ++i)
+	{
+		const Program *item = _desc->programList + i;
+		PipelineJob *job = &_workflow->pipelineJobs[i];
+
+		int bindingCount = 0;
+		for(int b = 0; b < _desc->dataCount; ++b)
 		{
-			VkDebugUtilsLabelEXT labelInfo = { VK_STRUCTURE_TYPE_DEBUG_UTILS_LABEL_EXT, 
-				0, "Memory Barrier", { 1.0f, 0.0f, 0.0f, 1.0f }};
-			vkCmdBeginDebugUtilsLabel(_workflow->graphicsCmdBuffers[0], &labelInfo);
-			vkCmdBeginDebugUtilsLabel(_workflow->graphicsCmdBuffers[1], &labelInfo);
-		}
+			if(item->access[b] == SpirvAccess_None) continue;
 
+			for(int s = 0; s < 2; ++s)
+			{
+				VkWriteDescriptorSet *write = descriptorWrites[s] + bindingCount;
+				write->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+				write->dstBinding = b;
+				write->dstArrayElement = 0;
+				write->descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+				write->descriptorCount = 1;
+				write->pBufferInfo = &bufferInfos[s][b];
+			}
+			++bindingCount;
+		}
 
-		vkCmdPipelineBarrier(_workflow->graphicsCmdBuffers[0], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, 0, 0, 0);
-		vkCmdPipelineBarrier(_workflow->graphicsCmdBuffers[1], VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 
-				VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, 0, 0, 0);
+		VkDescriptorSetLayout setLayouts[2] = { job->descriptorLayout, job->descriptorLayout };
+		VkDescriptorSetAllocateInfo allocInfo;
+		memset(&allocInfo, 0, sizeof(VkDescriptorSetAllocateInfo));
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = _workflow->descriptorPool;
+		allocInfo.descriptorSetCount = 2;
+		allocInfo.pSetLayouts = setLayouts;
+		vkAllocateDescriptorSets(_compute->device, &allocInfo, job->descriptorSets);
 
-		if(DEBUG_MARKERS)
+		for(int b = 0; b < bindingCount; ++b)
 		{
-			vkCmdEndDebugUtilsLabel(_workflow->graphicsCmdBuffers[0]);
-			vkCmdEndDebugUtilsLabel(_workflow->graphicsCmdBuffers[1]);
+			descriptorWrites[0][b].dstSet = job->descriptorSets[0];
+			descriptorWrites[1][b].dstSet = job->descriptorSets[1];
 		}
+		vkUpdateDescriptorSets(_compute->device, bindingCount, descriptorWrites[0], 0, 0);
+		vkUpdateDescriptorSets(_compute->device, bindingCount, descriptorWrites[1], 0, 0);
 
+		// The slot is fixed per command buffer, other built-ins change every iteration
+		for(int w = 0; w < item->pushCount; ++w)
+			if(item->push[w].builtin != PushBuiltin_None && item->push[w].builtin != PushBuiltin_Slot) _workflow->dynamicPush = true;
 	}
 
-	if(DEBUG_MARKERS)
+	// Static workflows are recorded once, dynamic ones again before each submission
+	for(int s = 0; s < 2; ++s)
 	{
-		vkCmdEndDebugUtilsLabel(_workflow->graphicsCmdBuffers[0]);
-		vkCmdEndDebugUtilsLabel(_workflow->graphicsCmdBuffers[1]);
+		_workflow->push.iteration = s;
+		_workflow->push.iterations = (_iterations > 0) ? _iterations : 0;
+		_workflow->push.slot = s;
+		_workflow->push.ring = s % _workflow->prefetch;
+		recordGraphicsCmdBuffer(_workflow, _desc, s);
 	}
+}
 
-	vkEndCommandBuffer(_workflow->graphicsCmdBuffers[0]);
-	vkEndCommandBuffer(_workflow->graphicsCmdBuffers[1]);
+int computeCreateWorkflow(Compute *_compute, Workflow *_workflow, const Description *_desc)
+{
+	TaskPool *pool = taskCreatePool(0);
+	int iterations = createWorkflowResources(_compute, _workflow, _desc, pool);
+	recordWorkflowPrograms(_compute, _workflow, _desc, pool, iterations);
+	if(pool) taskDestroyPool(pool);
 
-	// Update iterations according to AIO workload count
-	for(const AIOWorkload &workload : _workflow->aioWorkload)
+	return iterations;
+}
+
+struct DescriptionLoad
+{
+	const char *source;
+	const Description *desc;
+};
+
+static void descriptionTask(void *_data)
+{
+	DescriptionLoad *load = (DescriptionLoad *) _data;
+	load->desc = descCreateCached(load->source);
+}
+
+static int submitAIOReads(AIO *_aio, Workflow *_workflow, AIOCmdBuffer **_cmdBuffers, int _next, int _last, int *_count)
+{
+	// A staging slot is free again once the previous transfer reading it has completed
+	for(; _next < *_count && _next <= _last; ++_next)
 	{
-		int filecount = (int) workload.files.size();
-		iterations = (filecount < iterations) ? filecount : iterations;
+		// A streamed scan that runs out settles the iteration count
+		if(!extendAIOWorkload(&_workflow->aioWorkload, _next)) { *_count = _next; break; }
+
+		AIOCmdBuffer *cmdBuffer = _cmdBuffers[_next % _workflow->prefetch];
+		aioBeginCmdBuffer(cmdBuffer);
+		createAIOCommands(_workflow, cmdBuffer, &_workflow->aioWorkload, Access_CPU_Write, _next);
+		aioEndCmdBuffer(cmdBuffer);
+		aioSubmitCmdBuffer(_aio, cmdBuffer);
 	}
 
-	return iterations;
+	return _next;
 }
 
 int computeExecuteWorkflow()
@@ -1080,28 +2203,84 @@ int computeExecuteWorkflow()
 		assert(ret == 1);
 	}
 
+	Clock launch;
+	clockGetTime(&launch);
+
+	//const char *source = "data/sha256.json";
+	//const char *source = "data/test.json";
+	//const char *source = "data/conv1.json";
+	const char *source = "data/conv2.json";
+	//const char *source = "data/conv3.json";
+
+	// Parsing the description reads the shaders and enumerates the directories, none of it needs the device
+	TaskPool *startup = taskCreatePool(0);
+	TaskGroup startupGroup = {};
+	DescriptionLoad load = { source, 0 };
+	if(startup) taskSubmit(startup, &startupGroup, descriptionTask, &load);
+	else descriptionTask(&load);
+
 	Compute device;
 	Workflow compute;
 	computeCreate(&device);
-	AIO *aio = aioCreate(256);
 
-	//const Description *desc = descCreateFromFile("data/sha256.json");
-	//const Description *desc = descCreateFromFile("data/test.json");
-	//const Description *desc = descCreateFromFile("data/conv1.json");
-	const Description *desc = descCreateFromFile("data/conv2.json");
-	//const Description *desc = descCreateFromFile("data/conv3.json");
+	if(startup) taskWait(startup, &startupGroup);
+	const Description *desc = load.desc;
 
 	if(desc != 0)
 	{
-		int count = computeCreateWorkflow(&device, &compute, desc);
+		// Pipelines keep compiling on the startup pool until the programs are recorded
+		int count = createWorkflowResources(&device, &compute, desc, startup);
+
+		// Staging pools are mapped for the whole run, let the AIO backend pin them once
+		AIO *aio = aioCreate(256, desc->parameters.aio);
+		aioSetDirect(aio, desc->parameters.direct);
+		aioSetChunkSize(aio, desc->parameters.chunk);
+		aioSetWriteBehind(aio, desc->parameters.writeBehind);
+		aioSetAdaptiveDepth(aio, desc->parameters.adaptive);
+		aioRegisterBuffer(aio, compute.memory[Access_CPU_Write].mapped, desc->parameters.poolSizes[Access_CPU_Write]);
+		aioRegisterBuffer(aio, compute.memory[Access_CPU_Read].mapped, desc->parameters.poolSizes[Access_CPU_Read]);
+
+		// Unique files and packs are opened once for the whole run, directory files one iteration ahead
+		openAIOFiles(aio, &compute.aioUniqueWorkload, Access_CPU_Write, 0, true);
+		openAIOFiles(aio, &compute.aioUniqueWorkload, Access_CPU_Read, 0, true);
+		openAIOFiles(aio, &compute.aioWorkload, Access_CPU_Write, 0, false);
+
+		// One AIO command buffer per staging ring slot and direction, each one completes on its own
+		int prefetch = compute.prefetch;
+		AIOCmdBuffer *aioUniqueCmdBuffers[2] = { aioAllocCmdBuffer(aio), aioAllocCmdBuffer(aio) };
+		AIOCmdBuffer *aioReadCmdBuffers[MAX_PREFETCH];
+		AIOCmdBuffer *aioWriteCmdBuffers[MAX_PREFETCH];
+		for(int s = 0; s < prefetch; ++s)
+		{
+			aioReadCmdBuffers[s] = aioAllocCmdBuffer(aio);
+			aioWriteCmdBuffers[s] = aioAllocCmdBuffer(aio);
+		}
+
+		// The reads of the first iteration only need the staging memory, they go out while the last shaders compile
+		aioBeginCmdBuffer(aioUniqueCmdBuffers[0]);
+		createAIOCommands(&compute, aioUniqueCmdBuffers[0], &compute.aioUniqueWorkload, Access_CPU_Write, 0);
+		aioEndCmdBuffer(aioUniqueCmdBuffers[0]);
+		aioSubmitCmdBuffer(aio, aioUniqueCmdBuffers[0]);
+		int nextRead = submitAIOReads(aio, &compute, aioReadCmdBuffers, 0, prefetch - 2, &count);
+
+		recordWorkflowPrograms(&device, &compute, desc, startup, count);
+		if(startup) taskDestroyPool(startup);
+		startup = 0;
+
+		// Compressed inputs are decoded by a worker pool while the executor keeps the queues fed
+		bool compressed = false;
+		for(const AIOWorkload &workload : compute.aioWorkload) compressed = compressed || workload.compression != DataCompression_None;
+		for(const AIOWorkload &workload : compute.aioUniqueWorkload) compressed = compressed || workload.compression != DataCompression_None;
+		TaskPool *pool = compressed ? taskCreatePool(desc->parameters.workers) : 0;
+		if(compressed && pool == 0) printf("[Warning] No decompression worker could be started, decoding inline\n");
+		TaskGroup decodeGroups[MAX_PREFETCH] = {};
+		TaskGroup uniqueGroup = {};
 
 		VkSubmitInfo graphicsSubmit;
 		memset(&graphicsSubmit, 0, sizeof(VkSubmitInfo));
 		graphicsSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 		VkSubmitInfo transferSubmit = graphicsSubmit;
 
-		AIOCmdBuffer *aioCmdBuffers[2] = { aioAllocCmdBuffer(aio), aioAllocCmdBuffer(aio) };
-		
 		VkFence graphicsFences[2], transferFences[2], computeFences[2];
 		for(int i = 0; i < 2; ++i)
 		{
@@ -1113,6 +2292,17 @@ int computeExecuteWorkflow()
 		std::vector<double> timings;
 		timings.reserve(count + 4);
 
+		Clock ready;
+		clockGetTime(&ready);
+		double startupTime = clockDeltaTime(&launch, &ready);
+		std::vector<double> readLatencies, writeLatencies;
+
+		// Iteration i reads ahead up to item i+prefetch, uploads item i+1, computes item i,
+		// downloads item i-1 and writes item i-2
+		int nextDecode = 0;
+		int nextAdvise = 0;
+		int readahead = prefetch;
+		int quiet = 0;
 		for(int i = -2; i < count + 2; ++i)
 		{
 			Clock start;
@@ -1120,6 +2310,7 @@ int computeExecuteWorkflow()
 
 			int index = i + 2;
 			int lsb = index & 0x1;
+			int slot = (i + prefetch) % prefetch;
 			
 			if(rdoc_api) rdoc_api->StartFrameCapture(NULL, NULL);
 
@@ -1131,30 +2322,6 @@ int computeExecuteWorkflow()
 			transferSubmit.commandBufferCount = 0;
 			transferSubmit.pCommandBuffers = transferCB;
 
-			aioBeginCmdBuffer(aioCmdBuffers[lsb]);
-
-			if(i == -2)
-			{
-				createAIOCommands(&compute, aioCmdBuffers[lsb], &compute.aioUniqueWorkload, Access_CPU_Write, 0);
-			}
-			
-			if(i >= -2 && i < count)
-			{
-				createAIOCommands(&compute, aioCmdBuffers[lsb], &compute.aioWorkload, Access_CPU_Write, index);
-			}
-			
-			if(i == count + 1)
-			{
-				createAIOCommands(&compute, aioCmdBuffers[lsb], &compute.aioUniqueWorkload, Access_CPU_Read, 0);
-			}
-
-			if(i >= 2 && i < count + 2)
-			{
-				createAIOCommands(&compute, aioCmdBuffers[lsb], &compute.aioWorkload, Access_CPU_Read, index - 4);
-			}
-			
-			aioEndCmdBuffer(aioCmdBuffers[lsb]);
-
 			if(i == -1)
 			{
 				transferCB[transferSubmit.commandBufferCount] = compute.transferUniqueCmdBuffers[0];
@@ -1169,12 +2336,22 @@ int computeExecuteWorkflow()
 
 			if(i >= -1 && i < count + 1)
 			{
-				transferCB[transferSubmit.commandBufferCount] = compute.transferCmdBuffers[lsb];
+				transferCB[transferSubmit.commandBufferCount] = compute.transferCmdBuffers[slot];
 				++transferSubmit.commandBufferCount;
 			}
 
 			if(i >= 0 && i < count)
 			{
+				// The slot was last submitted two iterations ago and its fence waited on by the previous one
+				if(compute.dynamicPush)
+				{
+					compute.push.iteration = i;
+					compute.push.iterations = count;
+					compute.push.slot = lsb;
+					compute.push.ring = i % prefetch;
+					recordGraphicsCmdBuffer(&compute, desc, lsb);
+				}
+
 				graphicsCB[graphicsSubmit.commandBufferCount] = compute.graphicsCmdBuffers[lsb];
 				++graphicsSubmit.commandBufferCount;
 			}
@@ -1184,17 +2361,98 @@ int computeExecuteWorkflow()
 			{
 				vkWaitForFences(device.device, 1, &transferFences[lsb^1], VK_TRUE, UINT64_MAX);
 				vkResetFences(device.device, 1, &transferFences[lsb^1]);
+				collectQueryRing(&device, &compute.transferQueries, (i - 1 + prefetch) % prefetch);
 			}
 
 			vkQueueSubmit(device.graphicsQueue, 1, &graphicsSubmit, graphicsFences[lsb]);
 
-			aioWaitIdle(aio);
-			aioSubmitCmdBuffer(aio, aioCmdBuffers[lsb]);
+			nextRead = submitAIOReads(aio, &compute, aioReadCmdBuffers, nextRead, i + prefetch, &count);
+
+			if(i >= 2 && i < count + 2)
+			{
+				AIOCmdBuffer *cmdBuffer = aioWriteCmdBuffers[(i - 2) % prefetch];
+				convertAIOWorkload(&compute, &compute.aioWorkload, Access_CPU_Read, i - 2);
+				aioBeginCmdBuffer(cmdBuffer);
+				createAIOCommands(&compute, cmdBuffer, &compute.aioWorkload, Access_CPU_Read, i - 2);
+				aioEndCmdBuffer(cmdBuffer);
+				aioSubmitCmdBuffer(aio, cmdBuffer);
+			}
+
+			if(i == count + 1)
+			{
+				convertAIOWorkload(&compute, &compute.aioUniqueWorkload, Access_CPU_Read, 0);
+				aioBeginCmdBuffer(aioUniqueCmdBuffers[1]);
+				createAIOCommands(&compute, aioUniqueCmdBuffers[1], &compute.aioUniqueWorkload, Access_CPU_Read, 0);
+				aioEndCmdBuffer(aioUniqueCmdBuffers[1]);
+				aioSubmitCmdBuffer(aio, aioUniqueCmdBuffers[1]);
+			}
+
+			// Open the files of the next reads and writes while these ones are in flight
+			if(nextRead < count)
+				openAIOFiles(aio, &compute.aioWorkload, Access_CPU_Write, nextRead, false);
+			if(i - 1 >= 0 && i - 1 < count)
+				openAIOFiles(aio, &compute.aioWorkload, Access_CPU_Read, i - 1, false);
+
+			// Completed reads are handed to the workers in order, ahead of the upload needing them
+			for(; compressed && nextDecode < nextRead; ++nextDecode)
+			{
+				if(!aioPollCmdBuffer(aio, aioReadCmdBuffers[nextDecode % prefetch])) break;
+				decodeAIOWorkload(pool, &decodeGroups[nextDecode % prefetch], &compute, &compute.aioWorkload, nextDecode);
+			}
+
+			// Readahead covers the items past the staging ring
+			if(nextAdvise < nextRead) nextAdvise = nextRead;
+			for(; nextAdvise < count && nextAdvise < nextRead + readahead; ++nextAdvise)
+			{
+				if(!extendAIOWorkload(&compute.aioWorkload, nextAdvise)) break;
+				adviseAIOFiles(aio, &compute.aioWorkload, nextAdvise);
+			}
 
 			if(i > -2)
 			{
 				vkWaitForFences(device.device, 1, &graphicsFences[lsb^1], VK_TRUE, UINT64_MAX);
 				vkResetFences(device.device, 1, &graphicsFences[lsb^1]);
+				collectQueryRing(&device, &compute.graphicsQueries, lsb ^ 1);
+			}
+
+			// The upload needs its item in the staging slot, the download needs the previous write of its slot done
+			if(i == -1)
+			{
+				aioWaitCmdBuffer(aio, aioUniqueCmdBuffers[0]);
+				checkAIOCommands(aioUniqueCmdBuffers[0], &compute.aioUniqueWorkload, Access_CPU_Write, 0, &readLatencies);
+				if(compressed)
+				{
+					decodeAIOWorkload(pool, &uniqueGroup, &compute, &compute.aioUniqueWorkload, 0);
+					waitAIODecodes(pool, &uniqueGroup, &compute.aioUniqueWorkload, 0);
+				}
+				convertAIOWorkload(&compute, &compute.aioUniqueWorkload, Access_CPU_Write, 0);
+			}
+			if(i + 1 >= 0 && i + 1 < count)
+			{
+				// A read still in flight when needed means the disk is slower than the iterations, look further ahead.
+				// Shrink back slowly while reads keep arriving on time
+				bool stalled = !aioPollCmdBuffer(aio, aioReadCmdBuffers[(i + 1) % prefetch]);
+				if(stalled) { readahead = std::min(readahead * 2, MAX_READAHEAD); quiet = 0; }
+				else if(++quiet >= READAHEAD_DECAY) { readahead = std::max(readahead - 1, 1); quiet = 0; }
+
+				aioWaitCmdBuffer(aio, aioReadCmdBuffers[(i + 1) % prefetch]);
+				checkAIOCommands(aioReadCmdBuffers[(i + 1) % prefetch], &compute.aioWorkload, Access_CPU_Write, i + 1, &readLatencies);
+
+				if(compressed)
+				{
+					if(nextDecode == i + 1)
+					{
+						decodeAIOWorkload(pool, &decodeGroups[(i + 1) % prefetch], &compute, &compute.aioWorkload, i + 1);
+						++nextDecode;
+					}
+					waitAIODecodes(pool, &decodeGroups[(i + 1) % prefetch], &compute.aioWorkload, i + 1);
+				}
+				convertAIOWorkload(&compute, &compute.aioWorkload, Access_CPU_Write, i + 1);
+			}
+			if(i - 1 - prefetch >= 0 && i - 1 < count)
+			{
+				aioWaitCmdBuffer(aio, aioWriteCmdBuffers[(i - 1) % prefetch]);
+				checkAIOCommands(aioWriteCmdBuffers[(i - 1) % prefetch], &compute.aioWorkload, Access_CPU_Read, i - 1 - prefetch, &writeLatencies);
 			}
 
 			vkQueueSubmit(device.transferQueue, 1, &transferSubmit, transferFences[lsb]);
@@ -1209,11 +2467,36 @@ int computeExecuteWorkflow()
 		vkQueueWaitIdle(device.graphicsQueue);
 		vkQueueWaitIdle(device.transferQueue);
 
+		// Timestamps of the last submissions, no fence was waited on for them in the loop
+		for(int s = 0; s < 2; ++s) collectQueryRing(&device, &compute.graphicsQueries, s);
+		for(int s = 0; s < prefetch; ++s) collectQueryRing(&device, &compute.transferQueries, s);
+
+		// Writes still draining at the end of the loop
 		aioWaitIdle(aio);
-		aioFreeCmdBuffer(aioCmdBuffers[0]);
-		aioFreeCmdBuffer(aioCmdBuffers[1]);
+		for(int n = std::max(0, count - prefetch); n < count; ++n)
+			checkAIOCommands(aioWriteCmdBuffers[n % prefetch], &compute.aioWorkload, Access_CPU_Read, n, &writeLatencies);
+		checkAIOCommands(aioUniqueCmdBuffers[1], &compute.aioUniqueWorkload, Access_CPU_Read, 0, &writeLatencies);
 
-		descDestroy(desc);
+		if(pool) taskDestroyPool(pool);
+
+		// Output packs get their index once every record is written
+		for(const AIOWorkload &workload : compute.aioWorkload)
+			if(workload.sink) packFinish(workload.sink, count);
+
+		// Outputs are only complete once they are on disk
+		if(!aioFlush(aio)) printf("[Warning] AIO outputs could not be made durable\n");
+
+		AIOCounters counters;
+		aioGetCounters(aio, &counters);
+
+		aioFreeCmdBuffer(aioUniqueCmdBuffers[0]);
+		aioFreeCmdBuffer(aioUniqueCmdBuffers[1]);
+		for(int s = 0; s < prefetch; ++s)
+		{
+			aioFreeCmdBuffer(aioReadCmdBuffers[s]);
+			aioFreeCmdBuffer(aioWriteCmdBuffers[s]);
+		}
+		aioDestroy(aio);
 
 		double total = 0.0;
 		for(double t : timings) { total += t; }
@@ -1223,12 +2506,41 @@ int computeExecuteWorkflow()
 		for(double t : timings) { variance += (t - mean)*(t - mean); }
 		variance /= timings.size() - 1;
 
+		printf("[summary] startup = %f\n", startupTime);
 		printf("[summary] total = %f, mean = %f, sigma = %f\n", total, mean, sqrt(variance));
+		printf("[summary] readahead depth = %d\n", readahead);
+		printf("[summary] aio queue depth = %zu (peak %zu), %d grows, %d shrinks over %d windows, %d throttled submits\n",
+			counters.depth, counters.peakDepth, counters.grows, counters.shrinks, counters.windows, counters.throttled);
+		printf("[summary] aio last window: %f MB/s, latency = %f (baseline %f)\n",
+			counters.throughput / (1 << 20), counters.latency, counters.baseline);
+
+		std::vector<double> *latencies[2] = { &readLatencies, &writeLatencies };
+		for(int l = 0; l < 2; ++l)
+		{
+			if(latencies[l]->empty()) continue;
+			std::sort(latencies[l]->begin(), latencies[l]->end());
+			double sum = 0.0;
+			for(double t : *latencies[l]) { sum += t; }
+			printf("[summary] aio %s latency: mean = %f, max = %f\n", (l == 0) ? "read" : "write",
+				sum / latencies[l]->size(), latencies[l]->back());
+		}
+
+		// Device time of each program and each streamed copy, to tell which one bounds an iteration
+		for(int p = 0; p < (int) compute.graphicsQueries.samples.size(); ++p)
+			printTimings("program", desc->programList[p].name, "", &compute.graphicsQueries.samples[p]);
+		for(int p = 0; p < (int) compute.transferItems.size(); ++p)
+		{
+			const Data *item = desc->dataList + compute.transferItems[p];
+			printTimings("transfer", item->name, (item->access == DataAccess_Read) ? " upload" : " download", &compute.transferQueries.samples[p]);
+		}
+
+		descDestroy(desc);
 	}
 
+	if(startup) taskDestroyPool(startup);
+
 	computeDestroyWorkflow(&device, &compute);
 	computeDestroy(&device);
-	aioDestroy(aio);
 
 	return 0;
 }
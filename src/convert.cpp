@@ -0,0 +1,309 @@
+#include "convert.h"
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <immintrin.h>
+
+
+const size_t CONVERT_STREAM_ALIGNMENT = 32;
+
+
+static uint16_t convertSwap16(uint16_t _value)
+{
+	return (uint16_t) ((_value << 8) | (_value >> 8));
+}
+
+static float convertHalfToFloat(uint16_t _half)
+{
+	uint32_t sign = (uint32_t) (_half & 0x8000) << 16;
+	uint32_t exponent = (_half >> 10) & 0x1F;
+	uint32_t mantissa = _half & 0x3FF;
+	uint32_t bits;
+
+	if(exponent == 31) bits = sign | 0x7F800000 | (mantissa << 13) | (mantissa ? 0x400000 : 0); // Quiet NaN, like F16C
+	else if(exponent != 0) bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+	else if(mantissa == 0) bits = sign;
+	else
+	{
+		// Subnormal halves are normal floats
+		exponent = 113;
+		while((mantissa & 0x400) == 0) { mantissa <<= 1; --exponent; }
+		bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+	}
+
+	float value;
+	memcpy(&value, &bits, sizeof(float));
+	return value;
+}
+
+static uint16_t convertFloatToHalf(float _value)
+{
+	uint32_t bits;
+	memcpy(&bits, &_value, sizeof(float));
+	uint32_t sign = (bits >> 16) & 0x8000;
+	uint32_t mantissa = bits & 0x7FFFFF;
+	int exponent = (int) ((bits >> 23) & 0xFF);
+
+	if(exponent == 0xFF) return (uint16_t) (sign | 0x7C00 | (mantissa ? 0x200 : 0));
+	exponent += 15 - 127;
+	if(exponent >= 31) return (uint16_t) (sign | 0x7C00);
+
+	// Round to nearest even, a carry moves on to the exponent as it should
+	int shift = 13;
+	uint32_t half = sign | ((uint32_t) exponent << 10);
+	if(exponent <= 0)
+	{
+		if(exponent < -10) return (uint16_t) sign;
+		mantissa |= 0x800000;
+		shift = 14 - exponent;
+		half = sign;
+	}
+
+	uint32_t rest = mantissa & ((1u << shift) - 1);
+	uint32_t middle = 1u << (shift - 1);
+	half += mantissa >> shift;
+	if(rest > middle || (rest == middle && (half & 1))) ++half;
+
+	return (uint16_t) half;
+}
+
+static float convertLoad(const void *_src, size_t _index, ConvertFormat _format, bool _swap)
+{
+	switch(_format)
+	{
+		case ConvertFormat_U8: return ((const uint8_t *) _src)[_index];
+		case ConvertFormat_U16:
+		{
+			uint16_t value = ((const uint16_t *) _src)[_index];
+			return _swap ? convertSwap16(value) : value;
+		}
+		case ConvertFormat_F16:
+		{
+			uint16_t value = ((const uint16_t *) _src)[_index];
+			return convertHalfToFloat(_swap ? convertSwap16(value) : value);
+		}
+		default:
+		{
+			uint32_t bits = ((const uint32_t *) _src)[_index];
+			if(_swap) bits = __builtin_bswap32(bits);
+			float value;
+			memcpy(&value, &bits, sizeof(float));
+			return value;
+		}
+	}
+}
+
+static void convertStore(void *_dst, size_t _index, float _value, ConvertFormat _format, bool _swap)
+{
+	switch(_format)
+	{
+		case ConvertFormat_U8:
+			((uint8_t *) _dst)[_index] = (uint8_t) ((_value <= 0.0f) ? 0 : (_value >= 255.0f) ? 255 : lrintf(_value));
+			break;
+		case ConvertFormat_U16:
+		{
+			uint16_t value = (uint16_t) ((_value <= 0.0f) ? 0 : (_value >= 65535.0f) ? 65535 : lrintf(_value));
+			((uint16_t *) _dst)[_index] = _swap ? convertSwap16(value) : value;
+			break;
+		}
+		case ConvertFormat_F16:
+		{
+			uint16_t value = convertFloatToHalf(_value);
+			((uint16_t *) _dst)[_index] = _swap ? convertSwap16(value) : value;
+			break;
+		}
+		default:
+		{
+			uint32_t bits;
+			memcpy(&bits, &_value, sizeof(float));
+			((uint32_t *) _dst)[_index] = _swap ? __builtin_bswap32(bits) : bits;
+			break;
+		}
+	}
+}
+
+static bool convertHasAVX2()
+{
+	static int supported = -1;
+	if(supported < 0) supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("f16c");
+	return supported != 0;
+}
+
+__attribute__((target("avx2,f16c")))
+static size_t convertToFloatAVX2(float *_dst, const void *_src, size_t _count, ConvertFormat _format, bool _swap, float _scale)
+{
+	const __m128i swap16 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	const __m256i swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+											3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	const __m256 scale = _mm256_set1_ps(_scale);
+	const char *src = (const char *) _src;
+	size_t size = convertElementSize(_format);
+
+	size_t i = 0;
+	for(; i + 8 <= _count; i += 8)
+	{
+		__m256 value;
+		const char *element = src + i * size;
+		if(_format == ConvertFormat_U8)
+			value = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *) element)));
+		else if(_format == ConvertFormat_F32)
+		{
+			__m256i bits = _mm256_loadu_si256((const __m256i *) element);
+			if(_swap) bits = _mm256_shuffle_epi8(bits, swap32);
+			value = _mm256_castsi256_ps(bits);
+		}
+		else
+		{
+			__m128i bits = _mm_loadu_si128((const __m128i *) element);
+			if(_swap) bits = _mm_shuffle_epi8(bits, swap16);
+			value = (_format == ConvertFormat_U16) ? _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(bits)) : _mm256_cvtph_ps(bits);
+		}
+
+		_mm256_stream_ps(_dst + i, _mm256_mul_ps(value, scale));
+	}
+
+	return i;
+}
+
+__attribute__((target("avx2,f16c")))
+static size_t convertFromFloatAVX2(void *_dst, const float *_src, size_t _count, ConvertFormat _format, bool _swap, float _scale)
+{
+	const __m128i swap16 = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	const __m256i swap32 = _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+											3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	const __m256 scale = _mm256_set1_ps(1.0f / _scale);
+	char *dst = (char *) _dst;
+	size_t size = convertElementSize(_format);
+
+	size_t i = 0;
+	for(; i + 8 <= _count; i += 8)
+	{
+		// Staging memory may be uncached, streaming loads keep the reads in whole lines
+		__m256 value = _mm256_castsi256_ps(_mm256_stream_load_si256((const __m256i *) (_src + i)));
+		value = _mm256_mul_ps(value, scale);
+		char *element = dst + i * size;
+
+		if(_format == ConvertFormat_F32)
+		{
+			__m256i bits = _mm256_castps_si256(value);
+			if(_swap) bits = _mm256_shuffle_epi8(bits, swap32);
+			_mm256_storeu_si256((__m256i *) element, bits);
+		}
+		else if(_format == ConvertFormat_F16)
+		{
+			__m128i bits = _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT);
+			if(_swap) bits = _mm_shuffle_epi8(bits, swap16);
+			_mm_storeu_si128((__m128i *) element, bits);
+		}
+		else
+		{
+			// Saturating packs clamp to the integer range
+			__m256i integers = _mm256_cvtps_epi32(value);
+			__m128i low = _mm256_castsi256_si128(integers);
+			__m128i high = _mm256_extracti128_si256(integers, 1);
+			if(_format == ConvertFormat_U8)
+				_mm_storel_epi64((__m128i *) element, _mm_packus_epi16(_mm_packs_epi32(low, high), _mm_setzero_si128()));
+			else
+			{
+				__m128i bits = _mm_packus_epi32(low, high);
+				if(_swap) bits = _mm_shuffle_epi8(bits, swap16);
+				_mm_storeu_si128((__m128i *) element, bits);
+			}
+		}
+	}
+
+	return i;
+}
+
+static size_t convertToFloatSSE(float *_dst, const void *_src, size_t _count, ConvertFormat _format, bool _swap, float _scale)
+{
+	// Only the integer formats have SSE2 widening, the others take the scalar path
+	if(_format != ConvertFormat_U8 && _format != ConvertFormat_U16) return 0;
+
+	const __m128 scale = _mm_set1_ps(_scale);
+	const __m128i zero = _mm_setzero_si128();
+
+	size_t i = 0;
+	for(; i + 4 <= _count; i += 4)
+	{
+		__m128i bits;
+		if(_format == ConvertFormat_U8)
+		{
+			uint32_t packed;
+			memcpy(&packed, (const uint8_t *) _src + i, sizeof(uint32_t));
+			bits = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128((int) packed), zero), zero);
+		}
+		else
+		{
+			bits = _mm_loadl_epi64((const __m128i *) ((const uint16_t *) _src + i));
+			if(_swap) bits = _mm_or_si128(_mm_slli_epi16(bits, 8), _mm_srli_epi16(bits, 8));
+			bits = _mm_unpacklo_epi16(bits, zero);
+		}
+
+		_mm_stream_ps(_dst + i, _mm_mul_ps(_mm_cvtepi32_ps(bits), scale));
+	}
+
+	return i;
+}
+
+static size_t convertFromFloatSSE(void *_dst, const float *_src, size_t _count, ConvertFormat _format, bool _swap, float _scale)
+{
+	if(_format != ConvertFormat_U8 && _format != ConvertFormat_U16) return 0;
+
+	const __m128 scale = _mm_set1_ps(1.0f / _scale);
+	const __m128i bias = _mm_set1_epi32(32768);
+	const __m128i flip = _mm_set1_epi16((short) 0x8000);
+
+	size_t i = 0;
+	for(; i + 8 <= _count; i += 8)
+	{
+		__m128i low = _mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(_src + i), scale));
+		__m128i high = _mm_cvtps_epi32(_mm_mul_ps(_mm_load_ps(_src + i + 4), scale));
+
+		if(_format == ConvertFormat_U8)
+			_mm_storel_epi64((__m128i *) ((uint8_t *) _dst + i), _mm_packus_epi16(_mm_packs_epi32(low, high), _mm_setzero_si128()));
+		else
+		{
+			// No unsigned 32 to 16 bit pack before SSE4.1, saturate around the signed range instead
+			__m128i bits = _mm_xor_si128(_mm_packs_epi32(_mm_sub_epi32(low, bias), _mm_sub_epi32(high, bias)), flip);
+			if(_swap) bits = _mm_or_si128(_mm_slli_epi16(bits, 8), _mm_srli_epi16(bits, 8));
+			_mm_storeu_si128((__m128i *) ((uint16_t *) _dst + i), bits);
+		}
+	}
+
+	return i;
+}
+
+size_t convertElementSize(ConvertFormat _format)
+{
+	static const size_t sizes[ConvertFormat_Count] = { 4, 1, 2, 2 };
+	return sizes[_format];
+}
+
+void convertToFloat(float *_dst, const void *_src, size_t _count, ConvertFormat _format, bool _swap, float _scale)
+{
+	// Scalar head up to the stream alignment, vector body, scalar tail
+	size_t head = 0;
+	while(head < _count && ((size_t) (_dst + head) % CONVERT_STREAM_ALIGNMENT) != 0) ++head;
+	for(size_t i = 0; i < head; ++i) _dst[i] = convertLoad(_src, i, _format, _swap) * _scale;
+
+	const char *src = (const char *) _src + head * convertElementSize(_format);
+	size_t done = convertHasAVX2() ? convertToFloatAVX2(_dst + head, src, _count - head, _format, _swap, _scale) :
+									convertToFloatSSE(_dst + head, src, _count - head, _format, _swap, _scale);
+	_mm_sfence();
+
+	for(size_t i = head + done; i < _count; ++i) _dst[i] = convertLoad(_src, i, _format, _swap) * _scale;
+}
+
+void convertFromFloat(void *_dst, const float *_src, size_t _count, ConvertFormat _format, bool _swap, float _scale)
+{
+	size_t head = 0;
+	while(head < _count && ((size_t) (_src + head) % CONVERT_STREAM_ALIGNMENT) != 0) ++head;
+	for(size_t i = 0; i < head; ++i) convertStore(_dst, i, _src[i] / _scale, _format, _swap);
+
+	char *dst = (char *) _dst + head * convertElementSize(_format);
+	size_t done = convertHasAVX2() ? convertFromFloatAVX2(dst, _src + head, _count - head, _format, _swap, _scale) :
+									convertFromFloatSSE(dst, _src + head, _count - head, _format, _swap, _scale);
+
+	for(size_t i = head + done; i < _count; ++i) convertStore(_dst, i, _src[i] / _scale, _format, _swap);
+}
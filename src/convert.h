@@ -0,0 +1,14 @@
+#pragma once
+#include <stddef.h> // size_t
+
+// Element formats of data items on disk, the GPU side always works on float32
+enum ConvertFormat { ConvertFormat_F32 = 0, ConvertFormat_U8, ConvertFormat_U16, ConvertFormat_F16, ConvertFormat_Count };
+
+size_t convertElementSize(ConvertFormat _format);
+
+// Expands packed elements into floats multiplied by the scale, optionally byte swapped first.
+// Floats are streamed with non-temporal stores, meant for write-combined staging memory
+void convertToFloat(float *_dst, const void *_src, size_t _count, ConvertFormat _format, bool _swap, float _scale);
+
+// Reverse conversion, floats are divided by the scale then rounded and saturated to integer formats
+void convertFromFloat(void *_dst, const float *_src, size_t _count, ConvertFormat _format, bool _swap, float _scale);
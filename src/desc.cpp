@@ -1,12 +1,56 @@
 #include "desc.h"
 
 #include <string.h>
+#include <stdint.h>
+#include <stdlib.h>
 #include <malloc.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "cJSON.h"
+#include "spirv.h"
 
 
-const size_t SAFE_ALIGNMENT = 1024;
 const char STRING_ANONYMOUS[] = "Anonymous";
+const char COMPILED_MAGIC[8] = { 'C', 'W', 'O', 'R', 'K', 'F', 'L', 'W' };
+const uint32_t COMPILED_VERSION = 3;
+const size_t COMPILED_ALIGNMENT = 8;
+const int COMPILED_SCAN_BATCH = 1024;
+
+// Binary workflow layout: header, Data and Program tables, heap of strings, SPIR-V and manifests,
+// then the dependency table. Pointers are stored as offsets from the start of the file, 0 being null
+struct CompiledHeader
+{
+	char magic[8];
+	uint64_t hash;
+	uint64_t size;
+	uint64_t dependencies;
+	uint32_t version;
+	uint32_t dependencyCount;
+	int32_t dataCount;
+	int32_t programCount;
+	Parameters parameters;
+};
+
+struct CompiledWriter
+{
+	char *buffer;
+	size_t size;
+	size_t capacity;
+};
+
+struct CompiledScan
+{
+	const char *path;
+	CompiledWriter names;
+	CompiledWriter entries;
+	CompiledWriter *heap;
+	CompiledWriter *dependencies;
+	uint64_t *hash;
+	int count;
+};
 
 
 static size_t alignSize(size_t _size, size_t _alignment = SAFE_ALIGNMENT)
@@ -27,8 +71,66 @@ static bool descParseParam(Description *_description, const cJSON *_param)
 		_description->parameters.iterations = 8;
 	}
 
-	// Initialize the memory pools to minimum SAFE_ALIGNMENT
-	for(int i = 0; i < Access_Count; ++i) _description->parameters.poolSizes[i] = SAFE_ALIGNMENT;
+	// Staging ring depth, the GPU side stays double buffered so it has to be even
+	const cJSON *prefetch = cJSON_GetObjectItem(_param, "prefetch");
+	if(prefetch && cJSON_IsNumber(prefetch))
+	{
+		int depth = cJSON_GetNumberValue(prefetch);
+		int clamped = (depth < 2) ? 2 : (depth > MAX_PREFETCH) ? MAX_PREFETCH : depth + (depth & 0x1);
+		if(clamped != depth) printf("[Warning] JSON param.prefetch=%d is not an even value in [2, %d], using %d\n", depth, MAX_PREFETCH, clamped);
+		_description->parameters.prefetch = clamped;
+	}
+	else _description->parameters.prefetch = 2;
+
+	const cJSON *aio = cJSON_GetObjectItem(_param, "aio");
+	if(aio && cJSON_IsString(aio))
+	{
+		const char *backend = cJSON_GetStringValue(aio);
+		if(strcmp(backend, "libaio") == 0) _description->parameters.aio = AIOBackend_Libaio;
+		else if(strcmp(backend, "uring") == 0) _description->parameters.aio = AIOBackend_Uring;
+		else if(strcmp(backend, "pool") == 0) _description->parameters.aio = AIOBackend_Pool;
+		else { printf("[Error] JSON param.aio=%s doesn't match any known value\n", backend); result = false; }
+	}
+	else _description->parameters.aio = AIOBackend_Libaio;
+
+	const cJSON *direct = cJSON_GetObjectItem(_param, "direct");
+	_description->parameters.direct = direct && cJSON_IsTrue(direct);
+
+	// The AIO queue depth follows the device latency unless disabled, the whole queue is used then
+	const cJSON *adaptive = cJSON_GetObjectItem(_param, "adaptive");
+	_description->parameters.adaptive = !adaptive || !cJSON_IsFalse(adaptive);
+
+	// Read only file items are mapped and imported as host memory instead of going through the staging pool
+	const cJSON *mmap = cJSON_GetObjectItem(_param, "mmap");
+	_description->parameters.mmap = mmap && cJSON_IsTrue(mmap);
+
+	// Directory inputs are handed out while they are scanned, in enumeration order instead of sorted
+	const cJSON *stream = cJSON_GetObjectItem(_param, "stream");
+	_description->parameters.stream = stream && cJSON_IsTrue(stream);
+
+	// Memory items whose lifetimes don't overlap share the same device memory unless disabled
+	const cJSON *alias = cJSON_GetObjectItem(_param, "alias");
+	_description->parameters.alias = !alias || !cJSON_IsFalse(alias);
+
+	// Stripe size of large file transfers in bytes, 0 disables striping. Stripes start on aligned offsets
+	const cJSON *chunk = cJSON_GetObjectItem(_param, "chunk");
+	if(chunk && cJSON_IsNumber(chunk))
+	{
+		double size = cJSON_GetNumberValue(chunk);
+		size_t aligned = (size > 0.0) ? alignSize((size_t) size) : 0;
+		if(size != (double) aligned) printf("[Warning] JSON param.chunk=%g is not a non-negative multiple of %lu, using %lu\n", size, SAFE_ALIGNMENT, aligned);
+		_description->parameters.chunk = aligned;
+	}
+	else _description->parameters.chunk = AIO_DEFAULT_CHUNK;
+
+	// Dirty page budget of buffered output writes in bytes, 0 disables write-behind
+	const cJSON *writeBehind = cJSON_GetObjectItem(_param, "writebehind");
+	_description->parameters.writeBehind = (writeBehind && cJSON_IsNumber(writeBehind)) ? 
+									(size_t) cJSON_GetNumberValue(writeBehind) : AIO_DEFAULT_WRITE_BEHIND;
+
+	// Decompression threads, 0 uses every core but the executor one
+	const cJSON *workers = cJSON_GetObjectItem(_param, "workers");
+	_description->parameters.workers = (workers && cJSON_IsNumber(workers)) ? (int) cJSON_GetNumberValue(workers) : 0;
 
 	return result;
 }
@@ -53,6 +155,21 @@ static bool descParseData(Description *_description, const cJSON *_data)
 		const cJSON *access = cJSON_GetObjectItem(item, "access");
 		const cJSON *path = cJSON_GetObjectItem(item, "path");
 		const cJSON *name = cJSON_GetObjectItem(item, "name");
+		const cJSON *pattern = cJSON_GetObjectItem(item, "pattern");
+		const cJSON *recursive = cJSON_GetObjectItem(item, "recursive");
+		const cJSON *layout = cJSON_GetObjectItem(item, "layout");
+		const cJSON *compression = cJSON_GetObjectItem(item, "compression");
+		const cJSON *offset = cJSON_GetObjectItem(item, "offset");
+		const cJSON *stride = cJSON_GetObjectItem(item, "stride");
+		const cJSON *format = cJSON_GetObjectItem(item, "format");
+		const cJSON *swap = cJSON_GetObjectItem(item, "swap");
+		const cJSON *normalize = cJSON_GetObjectItem(item, "normalize");
+
+		// Only compiled workflows carry directory manifests
+		_description->dataList[i].manifest = 0;
+		_description->dataList[i].manifestCount = 0;
+		_description->dataList[i].path = 0;
+		_description->dataList[i].poolOffset = 0;
 
 		// [Mandatory] size parsing
 		if(size && cJSON_IsNumber(size)) _description->dataList[i].size = cJSON_GetNumberValue(size);
@@ -65,6 +182,7 @@ static bool descParseData(Description *_description, const cJSON *_data)
 			if(strcmp(src, "file") == 0) _description->dataList[i].source = DataSource_File;
 			else if(strcmp(src, "directory") == 0) _description->dataList[i].source = DataSource_Directory;
 			else if(strcmp(src, "memory") == 0) _description->dataList[i].source = DataSource_Memory;
+			else if(strcmp(src, "pack") == 0) _description->dataList[i].source = DataSource_Pack;
 			else { printf("[Error] JSON data[%d].source=%s, doesn't match any known value\n", i, src); result = false; }
 		}
 		else { printf("[Error] JSON data[%d].source is not provided, it can't be deduced\n", i); result = false; }
@@ -91,6 +209,12 @@ static bool descParseData(Description *_description, const cJSON *_data)
 					printf("[Error] JSON data[%d],access=%s doesn't match any known value\n", i, acc);
 					result = false; 
 				}
+
+				if(_description->dataList[i].source == DataSource_Pack && _description->dataList[i].access != DataAccess_Read)
+				{
+					printf("[Error] JSON data[%d].access=%s is not supported by source = \"pack\", it is read only\n", i, acc);
+					result = false;
+				}
 			}
 			else { printf("[Warning] JSON data[%d].access=%s will be ignored since source = \"memory\"\n", i, acc); }
 		}
@@ -134,46 +258,127 @@ static bool descParseData(Description *_description, const cJSON *_data)
 			_description->dataList[i].name = STRING_ANONYMOUS;
 		}
 
-		// Accumulate memory required from the different pools for this data item
-		const Data *dataItem = _description->dataList + i;		
-		size_t *poolSizes = _description->parameters.poolSizes;
-		size_t asize = alignSize(dataItem->size);
-		switch(dataItem->source)
+		// [Optional] directory scan parsing, file name glob and sub directories
+		_description->dataList[i].pattern = (pattern && cJSON_IsString(pattern)) ? cJSON_GetStringValue(pattern) : 0;
+		_description->dataList[i].recursive = recursive && cJSON_IsTrue(recursive);
+		if((_description->dataList[i].pattern || _description->dataList[i].recursive) && 
+			(_description->dataList[i].source != DataSource_Directory || _description->dataList[i].access != DataAccess_Read))
+			printf("[Warning] JSON data[%d].pattern/recursive only apply to source = \"directory\" with read access\n", i);
+
+		// [Optional] layout parsing, directory outputs go to a single pack unless one file per iteration is asked
+		_description->dataList[i].layout = DataLayout_Pack;
+		if(layout && cJSON_IsString(layout))
 		{
-			case DataSource_File:
-				if(dataItem->access == DataAccess_Read)
-				{
-					poolSizes[Access_CPU_Write] += asize;
-					poolSizes[Access_GPU_Read] += asize;
-				}
-				else if(dataItem->access == DataAccess_Write)
-				{
-					poolSizes[Access_CPU_Read] += asize;
-					poolSizes[Access_GPU_Write] += asize;
-				}
-				break;
-			case DataSource_Directory:
-				if(dataItem->access == DataAccess_Read)
-				{
-					poolSizes[Access_CPU_Write] += 2*asize;
-					poolSizes[Access_GPU_Read] += 2*asize;
-				}
-				else if(dataItem->access == DataAccess_Write)
-				{
-					poolSizes[Access_CPU_Read] += 2*asize;
-					poolSizes[Access_GPU_Write] += 2*asize;
-				}
-				break;
-			case DataSource_Memory:
-				poolSizes[Access_GPU_ReadWrite] += asize;
-				break;
+			const char *lyt = cJSON_GetStringValue(layout);
+			if(strcmp(lyt, "pack") == 0) _description->dataList[i].layout = DataLayout_Pack;
+			else if(strcmp(lyt, "files") == 0) _description->dataList[i].layout = DataLayout_Files;
+			else { printf("[Error] JSON data[%d].layout=%s doesn't match any known value\n", i, lyt); result = false; }
+		}
+
+		// [Optional] compression parsing, compressed inputs are decoded by the CPU workers into the staging ring
+		_description->dataList[i].compression = DataCompression_None;
+		if(compression && cJSON_IsString(compression))
+		{
+			const char *cmp = cJSON_GetStringValue(compression);
+			if(strcmp(cmp, "none") == 0) _description->dataList[i].compression = DataCompression_None;
+			else if(strcmp(cmp, "lz4") == 0) _description->dataList[i].compression = DataCompression_LZ4;
+			else { printf("[Error] JSON data[%d].compression=%s doesn't match any known value\n", i, cmp); result = false; }
+
+			bool supported = (_description->dataList[i].source == DataSource_File || _description->dataList[i].source == DataSource_Directory) &&
+				_description->dataList[i].access == DataAccess_Read;
+			if(_description->dataList[i].compression != DataCompression_None && !supported)
+			{
+				printf("[Warning] JSON data[%d].compression only applies to source = \"file\" or \"directory\" with read access\n", i);
+				_description->dataList[i].compression = DataCompression_None;
+			}
+		}
+
+		// [Optional] sub-range parsing, several items can share a file at different offsets.
+		// A stride walks a single file record by record, one per iteration
+		_description->dataList[i].offset = (offset && cJSON_IsNumber(offset)) ? (size_t) cJSON_GetNumberValue(offset) : 0;
+		_description->dataList[i].stride = (stride && cJSON_IsNumber(stride)) ? (size_t) cJSON_GetNumberValue(stride) : 0;
+		bool ranged = (_description->dataList[i].offset | _description->dataList[i].stride) != 0;
+		bool rangeable = (_description->dataList[i].source == DataSource_File || _description->dataList[i].source == DataSource_Directory) &&
+			_description->dataList[i].access == DataAccess_Read && _description->dataList[i].compression == DataCompression_None;
+		if(ranged && !rangeable)
+		{
+			printf("[Warning] JSON data[%d].offset/stride only apply to uncompressed source = \"file\" or \"directory\" with read access\n", i);
+			_description->dataList[i].offset = _description->dataList[i].stride = 0;
+		}
+		if(_description->dataList[i].stride != 0 && _description->dataList[i].source != DataSource_File)
+		{
+			printf("[Warning] JSON data[%d].stride only applies to source = \"file\"\n", i);
+			_description->dataList[i].stride = 0;
+		}
+
+		// [Optional] element format parsing, items are float32 on the GPU and converted from/to this format on disk.
+		// Byte swapping reads big endian data, normalization maps the integer range to [0, 1]
+		_description->dataList[i].format = ConvertFormat_F32;
+		if(format && cJSON_IsString(format))
+		{
+			const char *fmt = cJSON_GetStringValue(format);
+			if(strcmp(fmt, "f32") == 0) _description->dataList[i].format = ConvertFormat_F32;
+			else if(strcmp(fmt, "u8") == 0) _description->dataList[i].format = ConvertFormat_U8;
+			else if(strcmp(fmt, "u16") == 0) _description->dataList[i].format = ConvertFormat_U16;
+			else if(strcmp(fmt, "f16") == 0) _description->dataList[i].format = ConvertFormat_F16;
+			else { printf("[Error] JSON data[%d].format=%s doesn't match any known value\n", i, fmt); result = false; }
 		}
+		_description->dataList[i].swap = swap && cJSON_IsTrue(swap);
+		_description->dataList[i].normalize = normalize && cJSON_IsTrue(normalize);
+
+		bool converted = _description->dataList[i].format != ConvertFormat_F32 || _description->dataList[i].swap;
+		if(converted && (_description->dataList[i].source == DataSource_Memory || _description->dataList[i].compression != DataCompression_None))
+		{
+			printf("[Warning] JSON data[%d].format/swap don't apply to source = \"memory\" or compressed items\n", i);
+			_description->dataList[i].format = ConvertFormat_F32;
+			_description->dataList[i].swap = false;
+		}
+		else if(converted && (_description->dataList[i].size % sizeof(float)) != 0)
+		{
+			printf("[Error] JSON data[%d].size=%zu is not a whole number of float32 elements\n", i, _description->dataList[i].size);
+			result = false;
+		}
+		if(_description->dataList[i].normalize && 
+			_description->dataList[i].format != ConvertFormat_U8 && _description->dataList[i].format != ConvertFormat_U16)
+			printf("[Warning] JSON data[%d].normalize only applies to format = \"u8\" or \"u16\"\n", i);
 	}
 
 	return result;
 }
 
 
+static bool descParsePush(const cJSON *_entry, PushConstant *_push)
+{
+	_push->builtin = PushBuiltin_None;
+	_push->value = 0;
+
+	if(cJSON_IsString(_entry))
+	{
+		const char *builtin = cJSON_GetStringValue(_entry);
+		if(strcmp(builtin, "iteration") == 0) _push->builtin = PushBuiltin_Iteration;
+		else if(strcmp(builtin, "iterations") == 0) _push->builtin = PushBuiltin_Iterations;
+		else if(strcmp(builtin, "slot") == 0) _push->builtin = PushBuiltin_Slot;
+		else if(strcmp(builtin, "ring") == 0) _push->builtin = PushBuiltin_Ring;
+		return _push->builtin != PushBuiltin_None;
+	}
+
+	// Whole numbers are pushed as int or uint, which share their bits, fractions as float
+	const cJSON *number = _entry;
+	bool typed = cJSON_IsObject(_entry) && cJSON_GetArraySize(_entry) == 1;
+	if(typed) number = _entry->child;
+	if(!cJSON_IsNumber(number)) return false;
+
+	double value = cJSON_GetNumberValue(number);
+	bool integral = value == (int64_t) value;
+	bool asFloat = typed ? strcmp(number->string, "float") == 0 : !integral;
+	if(typed && !asFloat && strcmp(number->string, "int") != 0 && strcmp(number->string, "uint") != 0) return false;
+
+	if(asFloat) { float f = (float) value; memcpy(&_push->value, &f, 4); }
+	else if(value < 0.0) _push->value = (uint32_t) (int32_t) value;
+	else _push->value = (uint32_t) value;
+	return true;
+}
+
 static bool descParseProgram(Description *_description, const cJSON *_program)
 {
 	bool result = true;
@@ -190,6 +395,17 @@ static bool descParseProgram(Description *_description, const cJSON *_program)
 		const cJSON *dispatch = cJSON_GetObjectItem(item, "dispatch");
 		const cJSON *path = cJSON_GetObjectItem(item, "path");
 		const cJSON *name = cJSON_GetObjectItem(item, "name");
+		const cJSON *constants = cJSON_GetObjectItem(item, "constants");
+		const cJSON *push = cJSON_GetObjectItem(item, "push");
+
+		// Only compiled workflows carry the SPIR-V, it is loaded from the path otherwise
+		_description->programList[i].code = 0;
+		_description->programList[i].codeSize = 0;
+		_description->programList[i].access = 0;
+		_description->programList[i].constants = 0;
+		_description->programList[i].constantCount = 0;
+		_description->programList[i].pushCount = 0;
+		memset(_description->programList[i].push, 0, sizeof(_description->programList[i].push));
 
 		// [Mandatory] dispatch parsing
 		if(dispatch && cJSON_IsArray(dispatch) && (cJSON_GetArraySize(dispatch) == 3))
@@ -229,14 +445,342 @@ static bool descParseProgram(Description *_description, const cJSON *_program)
 		else
 		{
 			printf("[Warning] JSON program[%d].name is not provided, default (\"Anonymous\")\n", i);
-			_description->dataList[i].name = STRING_ANONYMOUS;
+			_description->programList[i].name = STRING_ANONYMOUS;
 		}
+
+		// [Optional] specialization constants, keyed by constant_id or by name, typed once the module is reflected
+		if(constants && cJSON_IsObject(constants))
+		{
+			int constantCount = cJSON_GetArraySize(constants);
+			Constant *list = (Constant *) malloc(sizeof(Constant) * (constantCount > 0 ? constantCount : 1));
+			memset(list, 0, sizeof(Constant) * (constantCount > 0 ? constantCount : 1));
+			_description->programList[i].constants = list;
+
+			for(const cJSON *entry = constants->child; entry; entry = entry->next)
+			{
+				if(cJSON_IsNumber(entry) || cJSON_IsBool(entry))
+				{
+					Constant *constant = list + _description->programList[i].constantCount++;
+					constant->name = entry->string;
+					constant->number = cJSON_IsBool(entry) ? (cJSON_IsTrue(entry) ? 1.0 : 0.0) : cJSON_GetNumberValue(entry);
+				}
+				else { printf("[Error] JSON program[%d].constants.%s is not a number or a boolean\n", i, entry->string); result = false; }
+			}
+		}
+		else if(constants) { printf("[Error] JSON program[%d].constants is not an object\n", i); result = false; }
+
+		// [Optional] push constants, one 32-bit word per entry in declaration order
+		if(push && cJSON_IsArray(push) && cJSON_GetArraySize(push) <= MAX_PUSH_WORDS)
+		{
+			Program *program = _description->programList + i;
+			for(const cJSON *entry = push->child; entry; entry = entry->next)
+			{
+				if(!descParsePush(entry, program->push + program->pushCount))
+				{
+					printf("[Error] JSON program[%d].push[%d] is invalid, expecting a number, a built-in (\"iteration\", " \
+							"\"iterations\", \"slot\", \"ring\") or a typed number ({\"float\": 1})\n", i, program->pushCount);
+					result = false;
+				}
+				++program->pushCount;
+			}
+		}
+		else if(push) { printf("[Error] JSON program[%d].push is not an array of up to %d words\n", i, MAX_PUSH_WORDS); result = false; }
+	}
+
+	return result;
+}
+
+
+static char *descReadText(const char *_path, size_t *_size = 0)
+{
+	char *buffer = 0;
+
+	FILE *fp = fopen(_path, "rb");
+	if(fp)
+	{
+		fseek(fp, 0, SEEK_END);
+		size_t size = ftell(fp);
+		fseek(fp, 0, SEEK_SET);
+
+		buffer = (char *) malloc(size + 1);
+		size = fread(buffer, 1, size, fp); buffer[size] = 0;
+		if(_size) *_size = size;
+		fclose(fp);
+	}
+
+	return buffer;
+}
+
+
+static void descResolveConstants(Program *_program, int _index, const char *_code, size_t _size)
+{
+	Constant *constants = (Constant *) _program->constants;
+	if(_program->constantCount == 0) return;
+
+	int count = _code ? spirvReflectConstants(_code, _size, 0, 0) : -1;
+	SpirvConstant *reflected = (SpirvConstant *) malloc(sizeof(SpirvConstant) * (count > 0 ? count : 1));
+	if(count > 0) spirvReflectConstants(_code, _size, reflected, count);
+
+	// Unmatched constants are dropped, a module that can't be reflected only takes them by id
+	int kept = 0;
+	for(int c = 0; c < _program->constantCount; ++c)
+	{
+		Constant constant = constants[c];
+		char *end = 0;
+		unsigned long id = strtoul(constant.name, &end, 10);
+		bool numeric = constant.name[0] >= '0' && constant.name[0] <= '9' && *end == 0;
+
+		const SpirvConstant *match = 0;
+		for(int r = 0; r < count && !match; ++r)
+		{
+			bool named = reflected[r].name && strcmp(reflected[r].name, constant.name) == 0;
+			if(named || (numeric && reflected[r].id == id)) match = reflected + r;
+		}
+
+		SpirvConstant guess = { (unsigned) id, (constant.number == (int64_t) constant.number) ?
+			((constant.number < 0.0) ? SpirvConstant_Int : SpirvConstant_Uint) : SpirvConstant_Float, 32, 0 };
+		if(!match && numeric && count < 0) match = &guess;
+		if(!match)
+		{
+			printf("[Warning] program[%d].constants.%s doesn't match any specialization constant of %s\n", _index, constant.name, _program->path);
+			continue;
+		}
+
+		bool integral = constant.number == (int64_t) constant.number;
+		if(!integral && match->type != SpirvConstant_Float)
+			printf("[Warning] program[%d].constants.%s=%g is truncated to an integer\n", _index, constant.name, constant.number);
+
+		// Booleans are passed as VkBool32, other constants with the width of their type
+		constant.id = match->id;
+		constant.size = (match->type == SpirvConstant_Bool) ? 4 : match->width / 8;
+		if(match->type == SpirvConstant_Bool) constant.value = constant.number != 0.0;
+		else if(match->type == SpirvConstant_Float && match->width == 32) { float f = (float) constant.number; uint32_t bits; memcpy(&bits, &f, 4); constant.value = bits; }
+		else if(match->type == SpirvConstant_Float && match->width == 64) memcpy(&constant.value, &constant.number, 8);
+		else if(match->type == SpirvConstant_Int && match->width == 32) constant.value = (uint32_t) (int32_t) constant.number;
+		else if(match->type == SpirvConstant_Int && match->width == 64) constant.value = (uint64_t) (int64_t) constant.number;
+		else if(match->type == SpirvConstant_Uint && match->width == 32) constant.value = (uint32_t) constant.number;
+		else if(match->type == SpirvConstant_Uint && match->width == 64) constant.value = (uint64_t) constant.number;
+		else
+		{
+			printf("[Warning] program[%d].constants.%s has an unsupported %u-bit type\n", _index, constant.name, match->width);
+			continue;
+		}
+
+		bool duplicate = false;
+		for(int k = 0; k < kept; ++k) duplicate = duplicate || constants[k].id == constant.id;
+		if(duplicate) printf("[Warning] program[%d].constants.%s sets constant_id %u twice, the first value is used\n", _index, constant.name, constant.id);
+		else constants[kept++] = constant;
+	}
+
+	_program->constantCount = kept;
+	free(reflected);
+}
+
+static bool descReflectPrograms(Description *_description)
+{
+	bool result = true;
+	int dataCount = _description->dataCount;
+	for(int i = 0; i < dataCount; ++i) _description->dataList[i].usage = SpirvAccess_None;
+
+	// Bindings follow the data order, programs that can't be reflected are assumed to access every item
+	for(int p = 0; p < _description->programCount; ++p)
+	{
+		Program *program = _description->programList + p;
+		size_t size = 0;
+		char *code = descReadText(program->path, &size);
+
+		unsigned char access[MAX_BINDINGS];
+		const char *names[MAX_BINDINGS];
+		memset(access, 0, sizeof(access));
+		memset(names, 0, sizeof(names));
+		bool valid = code && spirvReflectAccess(code, size, access, MAX_BINDINGS, names);
+		if(!valid) printf("[Warning] program[%d].path=%s can't be reflected, it binds every data item\n", p, program->path);
+
+		unsigned char *list = (unsigned char *) malloc(dataCount);
+		for(int i = 0; i < dataCount; ++i)
+		{
+			list[i] = valid ? access[i] : SpirvAccess_ReadWrite;
+			_description->dataList[i].usage |= list[i];
+		}
+		program->access = list;
+
+		for(int b = dataCount; valid && b < MAX_BINDINGS; ++b)
+			if(access[b]) printf("[Warning] program[%d] uses binding %d but there are only %d data items\n", p, b, dataCount);
+
+		// A shader variable named after another item means the JSON order doesn't match the bindings
+		for(int b = 0; valid && b < dataCount; ++b)
+			for(int i = 0; names[b] && i < dataCount; ++i)
+				if(i != b && strcmp(names[b], _description->dataList[i].name) == 0)
+					printf("[Warning] program[%d] binds %s at %d but data[%d] is named %s\n", p, names[b], b, i, names[b]);
+
+		descResolveConstants(program, p, code, size);
+
+		// The push range has to cover the whole block the shader declares, missing words are pushed as zeros
+		int pushSize = code ? spirvReflectPushConstants(code, size) : -1;
+		if(pushSize > (int) sizeof(uint32_t) * MAX_PUSH_WORDS)
+		{
+			printf("[Error] program[%d].path=%s reads %d bytes of push constants, only %d can be pushed\n", p, program->path,
+					pushSize, (int) sizeof(uint32_t) * MAX_PUSH_WORDS);
+			result = false;
+		}
+		else if(pushSize > (int) sizeof(uint32_t) * program->pushCount)
+		{
+			printf("[Warning] program[%d].push has %d words but %s reads %d bytes, the rest is zero\n", p, program->pushCount, program->path, pushSize);
+			program->pushCount = (pushSize + sizeof(uint32_t) - 1) / sizeof(uint32_t);
+		}
+		else if(pushSize == 0 && program->pushCount > 0)
+			printf("[Warning] program[%d].push is declared but %s doesn't read push constants\n", p, program->path);
+
+		free(code);
+	}
+
+	for(int i = 0; i < dataCount; ++i)
+	{
+		const Data *item = _description->dataList + i;
+		if(item->usage == SpirvAccess_None) printf("[Warning] data[%d] is not used by any program\n", i);
+		else if(item->source != DataSource_Memory && item->access == DataAccess_Read && !(item->usage & SpirvAccess_Read))
+			printf("[Warning] data[%d] is read from disk but no program reads it\n", i);
+		else if(item->source != DataSource_Memory && item->access == DataAccess_Write && !(item->usage & SpirvAccess_Write))
+			printf("[Warning] data[%d] is written to disk but no program writes it\n", i);
 	}
 
 	return result;
 }
 
 
+static void descPoolSizes(Description *_description)
+{
+	// Initialize the memory pools to minimum SAFE_ALIGNMENT
+	size_t *poolSizes = _description->parameters.poolSizes;
+	for(int i = 0; i < Access_Count; ++i) poolSizes[i] = SAFE_ALIGNMENT;
+
+	for(int i = 0; i < _description->dataCount; ++i)
+	{
+		// Accumulate memory required from the different pools for this data item, a strided file is iterated like a pack.
+		// Items no program uses are skipped unless they drive the iterations
+		const Data *dataItem = _description->dataList + i;
+		size_t asize = alignSize(dataItem->size);
+		bool strided = dataItem->source == DataSource_File && dataItem->stride != 0;
+		DataSource source = strided ? DataSource_Pack : dataItem->source;
+		if(dataItem->usage == SpirvAccess_None && (source == DataSource_File || source == DataSource_Memory)) continue;
+
+		switch(source)
+		{
+			case DataSource_File:
+				if(dataItem->access == DataAccess_Read)
+				{
+					bool mapped = _description->parameters.mmap && dataItem->compression == DataCompression_None && dataItem->offset == 0 &&
+									dataItem->format == ConvertFormat_F32 && !dataItem->swap;
+					if(!mapped) poolSizes[Access_CPU_Write] += asize;
+					poolSizes[Access_GPU_Read] += asize;
+				}
+				else if(dataItem->access == DataAccess_Write)
+				{
+					poolSizes[Access_CPU_Read] += asize;
+					poolSizes[Access_GPU_Write] += asize;
+				}
+				break;
+			case DataSource_Directory:
+			case DataSource_Pack:
+				if(dataItem->access == DataAccess_Read)
+				{
+					poolSizes[Access_CPU_Write] += _description->parameters.prefetch*asize;
+					poolSizes[Access_GPU_Read] += 2*asize;
+				}
+				else if(dataItem->access == DataAccess_Write)
+				{
+					poolSizes[Access_CPU_Read] += _description->parameters.prefetch*asize;
+					poolSizes[Access_GPU_Write] += 2*asize;
+				}
+				break;
+			case DataSource_Memory:
+				_description->dataList[i].poolOffset = poolSizes[Access_GPU_ReadWrite] - SAFE_ALIGNMENT;
+				poolSizes[Access_GPU_ReadWrite] += asize;
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+
+static void descAliasMemory(Description *_description)
+{
+	int dataCount = _description->dataCount;
+	int programCount = _description->programCount;
+
+	// Lifetime of every binding in program order, and how its first program accesses it
+	int *first = (int *) malloc(sizeof(int) * dataCount);
+	int *last = (int *) malloc(sizeof(int) * dataCount);
+	unsigned char *firstAccess = (unsigned char *) malloc(dataCount);
+	for(int i = 0; i < dataCount; ++i) { first[i] = last[i] = -1; firstAccess[i] = SpirvAccess_None; }
+
+	for(int p = 0; p < programCount; ++p)
+		for(int i = 0; i < dataCount; ++i)
+		{
+			unsigned char access = _description->programList[p].access[i];
+			if(access == SpirvAccess_None) continue;
+			if(first[i] < 0) { first[i] = p; firstAccess[i] = access; }
+			last[i] = p;
+		}
+
+	// Items first read, or read and written by the same program, carry their content across iterations and are
+	// live throughout. The others are placed largest first at the lowest offset free during their lifetime.
+	// Unused items get no memory at all
+	int *order = (int *) malloc(sizeof(int) * dataCount);
+	int placed = 0;
+	int transient = 0;
+	size_t peak = 0;
+	for(int i = 0; i < dataCount; ++i)
+	{
+		Data *item = _description->dataList + i;
+		if(item->source != DataSource_Memory) continue;
+		if(first[i] < 0) { item->poolOffset = 0; continue; }
+
+		if(firstAccess[i] != SpirvAccess_Write) { first[i] = 0; last[i] = programCount - 1; }
+		else ++transient;
+
+		int j = placed++;
+		for(; j > 0 && _description->dataList[order[j - 1]].size < item->size; --j) order[j] = order[j - 1];
+		order[j] = i;
+	}
+
+	for(int n = 0; n < placed; ++n)
+	{
+		Data *item = _description->dataList + order[n];
+		size_t asize = alignSize(item->size);
+		size_t offset = 0;
+
+		for(bool moved = true; moved;)
+		{
+			moved = false;
+			for(int m = 0; m < n; ++m)
+			{
+				const Data *other = _description->dataList + order[m];
+				bool live = first[order[m]] <= last[order[n]] && first[order[n]] <= last[order[m]];
+				bool overlap = other->poolOffset < offset + asize && offset < other->poolOffset + alignSize(other->size);
+				if(live && overlap) { offset = other->poolOffset + alignSize(other->size); moved = true; }
+			}
+		}
+
+		item->poolOffset = offset;
+		peak = (offset + asize > peak) ? offset + asize : peak;
+	}
+
+	size_t *poolSize = _description->parameters.poolSizes + Access_GPU_ReadWrite;
+	if(SAFE_ALIGNMENT + peak < *poolSize)
+	{
+		printf("[Info] Memory aliasing: %d transient items, %lu KiB saved\n", transient, (*poolSize - SAFE_ALIGNMENT - peak) / 1024);
+		*poolSize = SAFE_ALIGNMENT + peak;
+	}
+
+	free(first);
+	free(last);
+	free(firstAccess);
+	free(order);
+}
+
+
 static void descInfo(const Description *_description)
 {
 	if(_description)
@@ -244,6 +788,7 @@ static void descInfo(const Description *_description)
 		const size_t SIZE_IN_MIB = 1024*1024;
 		const size_t *poolSizes = _description->parameters.poolSizes;
 		printf("[Info] Iterations: %d\n", _description->parameters.iterations);
+		printf("[Info] Prefetch: %d\n", _description->parameters.prefetch);
 		printf("[Info] Data count: %d\n", _description->dataCount);
 		printf("[Info] Program count: %d\n", _description->programCount);
 		printf("[Info] Memory GPU Read: %lu MiB\n", poolSizes[Access_GPU_Read] / SIZE_IN_MIB);
@@ -304,8 +849,13 @@ const Description *descCreateFromMemory(const char *_buffer)
 	bool bdata = descParseData(description, data);
 	bool bprogram = descParseProgram(description, program);
 
-	bool success = bparam && bdata && bprogram;
+	bool success = bparam && bdata && bprogram && descReflectPrograms(description);
 	if(!success) { descDestroy(description); description = 0; }
+	else
+	{
+		descPoolSizes(description);
+		if(description->parameters.alias) descAliasMemory(description);
+	}
 
 	descInfo(description);
 	printf("[Info] JSON end parsing...\n");
@@ -318,22 +868,11 @@ const Description *descCreateFromFile(const char *_path)
 {
 	const Description *description = 0;
 
-	FILE *fp = fopen(_path, "r");
-	if(fp)
-	{
-		fseek(fp, 0, SEEK_END);
-		size_t size = ftell(fp);
-		fseek(fp, 0, SEEK_SET);
-
-		char *buffer = (char *) malloc(size + 1);
-		fread(buffer, 1, size, fp); buffer[size] = 0;
-		description = descCreateFromMemory(buffer);
-
-		free(buffer);
-		fclose(fp);
-	}
+	char *buffer = descReadText(_path);
+	if(buffer) description = descCreateFromMemory(buffer);
 	else printf("[Error] JSON file not found %s\n", _path);
 
+	free(buffer);
 	return description;
 }
 
@@ -342,8 +881,15 @@ void descDestroy(const Description *_description)
 {
 	if(_description)
 	{
-		cJSON *json = (cJSON *) _description->data;
-		cJSON_Delete(json);
+		// Compiled workflows point into their mapping instead of a JSON tree
+		if(_description->mapping) munmap(_description->mapping, _description->mappingSize);
+		else cJSON_Delete((cJSON *) _description->data);
+
+		for(int i = 0; !_description->mapping && i < _description->programCount; ++i)
+		{
+			free((void *) _description->programList[i].access);
+			free((void *) _description->programList[i].constants);
+		}
 
 		free(_description->dataList);
 		free(_description->programList);
@@ -352,3 +898,308 @@ void descDestroy(const Description *_description)
 }
 
 
+static uint64_t descHash(uint64_t _hash, const void *_data, size_t _size)
+{
+	// FNV-1a, only used to detect changes
+	const unsigned char *bytes = (const unsigned char *) _data;
+	for(size_t i = 0; i < _size; ++i) _hash = (_hash ^ bytes[i]) * 0x100000001b3ull;
+	return _hash;
+}
+
+static uint64_t descHashText(const char *_text)
+{
+	// Layout changes and relative paths resolved from another directory invalidate as well
+	uint64_t hash = 0xcbf29ce484222325ull;
+	size_t layout[4] = { COMPILED_VERSION, sizeof(Parameters), sizeof(Data), sizeof(Program) };
+	hash = descHash(hash, layout, sizeof(layout));
+
+	char cwd[PATH_MAX];
+	if(getcwd(cwd, PATH_MAX)) hash = descHash(hash, cwd, strlen(cwd));
+
+	return descHash(hash, _text, strlen(_text));
+}
+
+static uint64_t descHashFile(uint64_t _hash, const char *_path)
+{
+	// Directories change their modification time whenever an entry is added, removed or renamed
+	struct stat st;
+	bool found = stat(_path, &st) == 0;
+	int64_t state[3] = { found, found ? st.st_mtim.tv_sec * 1000000000ll + st.st_mtim.tv_nsec : 0, found ? (int64_t) st.st_size : 0 };
+	_hash = descHash(_hash, _path, strlen(_path) + 1);
+	return descHash(_hash, state, sizeof(state));
+}
+
+static size_t writerAppend(CompiledWriter *_writer, const void *_data, size_t _size, size_t _alignment = COMPILED_ALIGNMENT)
+{
+	size_t offset = alignSize(_writer->size, _alignment);
+	if(offset + _size > _writer->capacity)
+	{
+		size_t capacity = (_writer->capacity < 4096) ? 4096 : _writer->capacity;
+		while(capacity < offset + _size) capacity *= 2;
+		_writer->buffer = (char *) realloc(_writer->buffer, capacity);
+		_writer->capacity = capacity;
+	}
+
+	memset(_writer->buffer + _writer->size, 0, offset - _writer->size);
+	if(_data) memcpy(_writer->buffer + offset, _data, _size);
+	_writer->size = offset + _size;
+
+	return offset;
+}
+
+static size_t writerString(CompiledWriter *_writer, const char *_string)
+{
+	return _string ? writerAppend(_writer, _string, strlen(_string) + 1, 1) : 0;
+}
+
+static void writerDepend(CompiledWriter *_heap, CompiledWriter *_dependencies, uint64_t *_hash, const char *_path)
+{
+	uint64_t offset = writerString(_heap, _path);
+	writerAppend(_dependencies, &offset, sizeof(uint64_t));
+	*_hash = descHashFile(*_hash, _path);
+}
+
+static void compiledScanCallback(const char *_name, bool _directory, size_t _size, void *_data)
+{
+	CompiledScan *scan = (CompiledScan *) _data;
+
+	char path[PATH_MAX];
+	snprintf(path, PATH_MAX, "%s/%s", scan->path, _name);
+
+	// Sub directories are reported before their entries, so their state is captured before they are listed
+	if(_directory) writerDepend(scan->heap, scan->dependencies, scan->hash, path);
+	else
+	{
+		uint64_t offset = writerString(&scan->names, path);
+		writerAppend(&scan->entries, &offset, sizeof(uint64_t));
+		++scan->count;
+	}
+}
+
+static int compiledCompare(const void *_a, const void *_b, void *_names)
+{
+	const char *names = (const char *) _names;
+	return strcmp(names + *(const uint64_t *) _a, names + *(const uint64_t *) _b);
+}
+
+static uint64_t compiledManifest(const Data *_item, CompiledWriter *_heap, CompiledWriter *_dependencies, uint64_t *_hash, int *_count)
+{
+	CompiledScan scan;
+	memset(&scan, 0, sizeof(CompiledScan));
+	scan.path = _item->path;
+	scan.heap = _heap;
+	scan.dependencies = _dependencies;
+	scan.hash = _hash;
+
+	writerDepend(_heap, _dependencies, _hash, _item->path);
+
+	AIOScan *dir = aioBeginScan(_item->path, _item->pattern, _item->recursive, false);
+	if(dir == 0) return 0;
+
+	while(aioContinueScan(dir, compiledScanCallback, &scan, COMPILED_SCAN_BATCH) > 0) {}
+	aioEndScan(dir);
+
+	// Same byte order as the executor sort, the manifest is handed out as is
+	uint64_t *entries = (uint64_t *) scan.entries.buffer;
+	if(scan.count > 0) qsort_r(entries, scan.count, sizeof(uint64_t), compiledCompare, scan.names.buffer);
+
+	// NUL separated names, an empty manifest still holds a terminator
+	uint64_t manifest = (scan.count == 0) ? writerAppend(_heap, "", 1, 1) : 0;
+	for(int i = 0; i < scan.count; ++i)
+	{
+		size_t offset = writerString(_heap, scan.names.buffer + entries[i]);
+		if(i == 0) manifest = offset;
+	}
+
+	free(scan.names.buffer);
+	free(scan.entries.buffer);
+
+	*_count = scan.count;
+	return manifest;
+}
+
+static bool descSaveCompiled(const Description *_description, uint64_t _hash, const char *_path)
+{
+	CompiledWriter writer, dependencies;
+	memset(&writer, 0, sizeof(CompiledWriter));
+	memset(&dependencies, 0, sizeof(CompiledWriter));
+
+	// Tables are filled in place once the heap is written, the buffer moves while it grows
+	writerAppend(&writer, 0, sizeof(CompiledHeader));
+	size_t dataTable = writerAppend(&writer, 0, sizeof(Data) * _description->dataCount);
+	size_t programTable = writerAppend(&writer, 0, sizeof(Program) * _description->programCount);
+	uint64_t hash = _hash;
+
+	for(int i = 0; i < _description->programCount; ++i)
+	{
+		Program program = _description->programList[i];
+		writerDepend(&writer, &dependencies, &hash, program.path);
+
+		size_t size = 0;
+		char *code = descReadText(program.path, &size);
+
+		program.code = (const void *) (code ? writerAppend(&writer, code, size) : 0);
+		program.codeSize = code ? size : 0;
+		program.access = (const unsigned char *) writerAppend(&writer, program.access, _description->dataCount, 1);
+
+		// Names are only needed while resolving, the constants are stored without them
+		Constant *constants = (Constant *) malloc(sizeof(Constant) * (program.constantCount > 0 ? program.constantCount : 1));
+		for(int c = 0; c < program.constantCount; ++c) { constants[c] = program.constants[c]; constants[c].name = 0; }
+		program.constants = (const Constant *) (program.constantCount > 0 ? writerAppend(&writer, constants, sizeof(Constant) * program.constantCount) : 0);
+		free(constants);
+		program.name = (const char *) writerString(&writer, program.name);
+		program.path = (const char *) writerString(&writer, program.path);
+		memcpy(writer.buffer + programTable + sizeof(Program) * i, &program, sizeof(Program));
+		free(code);
+	}
+
+	for(int i = 0; i < _description->dataCount; ++i)
+	{
+		Data data = _description->dataList[i];
+
+		// Streamed scans and compressed items depend on what the directory holds at execution time
+		bool listed = data.source == DataSource_Directory && data.access == DataAccess_Read &&
+						data.compression == DataCompression_None && !_description->parameters.stream;
+		if(listed) data.manifest = (const char *) compiledManifest(_description->dataList + i, &writer, &dependencies, &hash, &data.manifestCount);
+
+		data.name = (const char *) writerString(&writer, data.name);
+		data.path = (const char *) writerString(&writer, data.path);
+		data.pattern = (const char *) writerString(&writer, data.pattern);
+		memcpy(writer.buffer + dataTable + sizeof(Data) * i, &data, sizeof(Data));
+	}
+
+	size_t dependencyTable = writerAppend(&writer, dependencies.buffer, dependencies.size);
+
+	CompiledHeader *header = (CompiledHeader *) writer.buffer;
+	memcpy(header->magic, COMPILED_MAGIC, sizeof(COMPILED_MAGIC));
+	header->hash = hash;
+	header->size = writer.size;
+	header->dependencies = dependencyTable;
+	header->version = COMPILED_VERSION;
+	header->dependencyCount = dependencies.size / sizeof(uint64_t);
+	header->dataCount = _description->dataCount;
+	header->programCount = _description->programCount;
+	header->parameters = _description->parameters;
+
+	// Written aside then renamed, concurrent runs never map a partial file
+	char temp[PATH_MAX];
+	snprintf(temp, PATH_MAX, "%s.%d", _path, (int) getpid());
+
+	bool result = false;
+	FILE *fp = fopen(temp, "wb");
+	if(fp)
+	{
+		result = fwrite(writer.buffer, 1, writer.size, fp) == writer.size;
+		result = (fclose(fp) == 0) && result;
+		result = result && rename(temp, _path) == 0;
+		if(!result) unlink(temp);
+	}
+
+	free(writer.buffer);
+	free(dependencies.buffer);
+
+	return result;
+}
+
+static bool compiledRelocate(const char *_base, size_t _size, const void **_pointer)
+{
+	size_t offset = (size_t) *_pointer;
+	if(offset >= _size) return false;
+	if(offset != 0) *_pointer = _base + offset;
+	return true;
+}
+
+static const Description *descLoadCompiled(const char *_path, uint64_t _hash)
+{
+	int fd = open(_path, O_RDONLY | O_CLOEXEC);
+	if(fd < 0) return 0;
+
+	struct stat st;
+	size_t size = (fstat(fd, &st) == 0) ? (size_t) st.st_size : 0;
+	void *mapping = (size >= sizeof(CompiledHeader)) ? mmap(0, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if(mapping == MAP_FAILED) return 0;
+
+	const char *base = (const char *) mapping;
+	const CompiledHeader *header = (const CompiledHeader *) mapping;
+	size_t tables = sizeof(CompiledHeader) + sizeof(Data) * (size_t) header->dataCount + sizeof(Program) * (size_t) header->programCount;
+	bool valid = memcmp(header->magic, COMPILED_MAGIC, sizeof(COMPILED_MAGIC)) == 0 && header->version == COMPILED_VERSION &&
+		header->size == size && header->dataCount >= 0 && header->programCount >= 0 && tables <= size &&
+		header->dependencies + sizeof(uint64_t) * (size_t) header->dependencyCount <= size;
+
+	// Every dependency is checked again, in the order it was recorded
+	uint64_t hash = _hash;
+	const uint64_t *dependencies = (const uint64_t *) (base + (valid ? header->dependencies : 0));
+	for(uint32_t i = 0; valid && i < header->dependencyCount; ++i)
+	{
+		valid = dependencies[i] < size && memchr(base + dependencies[i], 0, size - dependencies[i]) != 0;
+		if(valid) hash = descHashFile(hash, base + dependencies[i]);
+	}
+
+	if(!valid || hash != header->hash) { munmap(mapping, size); return 0; }
+
+	Description *description = (Description *) malloc(sizeof(Description));
+	memset(description, 0, sizeof(Description));
+	description->mapping = mapping;
+	description->mappingSize = size;
+	description->parameters = header->parameters;
+	description->dataCount = header->dataCount;
+	description->programCount = header->programCount;
+
+	// The tables are copied out of the mapping, only strings, SPIR-V and manifests are used in place
+	description->dataList = (Data *) malloc(sizeof(Data) * description->dataCount);
+	description->programList = (Program *) malloc(sizeof(Program) * description->programCount);
+	memcpy(description->dataList, base + sizeof(CompiledHeader), sizeof(Data) * description->dataCount);
+	memcpy(description->programList, base + sizeof(CompiledHeader) + sizeof(Data) * description->dataCount, sizeof(Program) * description->programCount);
+
+	for(int i = 0; valid && i < description->dataCount; ++i)
+	{
+		Data *data = description->dataList + i;
+		valid = compiledRelocate(base, size, (const void **) &data->name) && compiledRelocate(base, size, (const void **) &data->path) &&
+			compiledRelocate(base, size, (const void **) &data->pattern) && compiledRelocate(base, size, (const void **) &data->manifest);
+	}
+
+	for(int i = 0; valid && i < description->programCount; ++i)
+	{
+		Program *program = description->programList + i;
+		valid = (size_t) program->code + program->codeSize <= size && compiledRelocate(base, size, &program->code) &&
+			(size_t) program->access + description->dataCount <= size && compiledRelocate(base, size, (const void **) &program->access) &&
+			program->constantCount >= 0 && (size_t) program->constants + sizeof(Constant) * program->constantCount <= size &&
+			program->pushCount >= 0 && program->pushCount <= MAX_PUSH_WORDS &&
+			compiledRelocate(base, size, (const void **) &program->constants) &&
+			compiledRelocate(base, size, (const void **) &program->name) && compiledRelocate(base, size, (const void **) &program->path);
+	}
+
+	if(!valid) { descDestroy(description); return 0; }
+	return description;
+}
+
+const Description *descCreateCached(const char *_source)
+{
+	char *text = descReadText(_source);
+	if(text == 0) { printf("[Error] JSON file not found %s\n", _source); return 0; }
+
+	char path[PATH_MAX];
+	snprintf(path, PATH_MAX, "%s%s", _source, DESC_COMPILED_SUFFIX);
+	uint64_t hash = descHashText(text);
+
+	const Description *description = descLoadCompiled(path, hash);
+	if(description)
+	{
+		printf("[Info] Compiled workflow %s loaded\n", path);
+		descInfo(description);
+	}
+	else
+	{
+		// The freshly compiled form is used right away so directories are only scanned once
+		const Description *parsed = descCreateFromMemory(text);
+		if(parsed && descSaveCompiled(parsed, hash, path)) description = descLoadCompiled(path, hash);
+		else if(parsed) printf("[Warning] Compiled workflow %s can't be written\n", path);
+
+		if(description) { printf("[Info] Compiled workflow %s written\n", path); descDestroy(parsed); }
+		else description = parsed;
+	}
+
+	free(text);
+	return description;
+}
@@ -1,31 +1,93 @@
 #pragma once
 #include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+#include "aio.h" // AIOBackend
+#include "convert.h" // ConvertFormat
+
+// Minimum alignment of every item in the memory pools
+const size_t SAFE_ALIGNMENT = 1024;
+// Maximum depth of the staging ring used by directory data
+const int MAX_PREFETCH = 8;
+// Data items are bound in order, one binding each
+const int MAX_BINDINGS = 256;
+// Push constants are 32-bit words, 128 bytes is the size every device supports
+const int MAX_PUSH_WORDS = 32;
 
 enum DataType { DataType_Buffer = 0, DataType_Count };
 enum DataAccess { DataAccess_Read = 0, DataAccess_Write, DataAccess_Count };
-enum DataSource { DataSource_File = 0, DataSource_Directory, DataSource_Memory, DataSource_Count };
+enum DataSource { DataSource_File = 0, DataSource_Directory, DataSource_Memory, DataSource_Pack, DataSource_Count };
+enum DataLayout { DataLayout_Pack = 0, DataLayout_Files, DataLayout_Count };
+enum DataCompression { DataCompression_None = 0, DataCompression_LZ4, DataCompression_Count };
+enum PushBuiltin { PushBuiltin_None = 0, PushBuiltin_Iteration, PushBuiltin_Iterations, PushBuiltin_Slot, PushBuiltin_Ring, PushBuiltin_Count };
 enum Access { Access_GPU_Read = 0, Access_GPU_Write, Access_GPU_ReadWrite, Access_CPU_Read, Access_CPU_Write, Access_Count };
 
 struct Parameters
 { 
 	size_t poolSizes[Access_Count];
 	int iterations;
+	int prefetch;
+	int workers;
+	size_t chunk;
+	size_t writeBehind;
+	AIOBackend aio;
+	bool direct;
+	bool adaptive;
+	bool mmap;
+	bool stream;
+	bool alias;
 };
 
 struct Data
 {
 	const char *name;
 	const char *path;
+	const char *pattern;
 	size_t size;
+	size_t offset;
+	size_t stride;
+	size_t poolOffset;
 	DataSource source;
 	DataAccess access;
 	DataType type;
+	DataLayout layout;
+	DataCompression compression;
+	ConvertFormat format;
+	bool swap;
+	bool normalize;
+	bool recursive;
+	unsigned char usage;
+	const char *manifest;
+	int manifestCount;
+};
+
+// Specialization constant resolved against the module, value holds the size bytes handed to the driver
+struct Constant
+{
+	const char *name;
+	double number;
+	unsigned id;
+	unsigned size;
+	uint64_t value;
+};
+
+// Push constant word, built-ins are filled in from the iteration being recorded instead of value
+struct PushConstant
+{
+	PushBuiltin builtin;
+	uint32_t value;
 };
 
 struct Program
 {
 	const char *name;
 	const char *path;
+	const void *code;
+	size_t codeSize;
+	const unsigned char *access;
+	const Constant *constants;
+	int constantCount;
+	PushConstant push[MAX_PUSH_WORDS];
+	int pushCount;
 	size_t dispatch[3];
 };
 
@@ -37,9 +99,17 @@ struct Description
 	int dataCount;
 	int programCount;
 	void *data;
+	void *mapping;
+	size_t mappingSize;
 };
 
 const Description *descCreateFromFile(const char *_path);
 const Description *descCreateFromMemory(const char *_buffer);
 void descDestroy(const Description *_description);
 
+// Compiled workflows sit next to their JSON source and hold the resolved description, the sorted manifests of
+// directory inputs and the SPIR-V blobs. They are mapped as is, and compiled again when the JSON text or the
+// state of a file they depend on changes
+const char DESC_COMPILED_SUFFIX[] = ".bin";
+const Description *descCreateCached(const char *_source);
+
@@ -0,0 +1,144 @@
+#include "pack.h"
+#include <stdio.h>
+#include <string.h>
+#include <malloc.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+
+struct Pack
+{
+	PackRecord *records;
+	size_t count;
+};
+
+struct PackWriter
+{
+	char *path;
+	size_t recordSize;
+	size_t stride;
+	size_t capacity;
+};
+
+Pack *packOpen(const char *_path)
+{
+	FILE *fp = fopen(_path, "rb");
+	if(fp == 0) { printf("[Error] Pack %s can't be opened\n", _path); return 0; }
+
+	Pack *pack = 0;
+	PackFooter footer;
+	fseeko(fp, 0, SEEK_END);
+	off_t size = ftello(fp);
+
+	bool valid = size >= (off_t) sizeof(PackFooter) && fseeko(fp, size - sizeof(PackFooter), SEEK_SET) == 0 &&
+				fread(&footer, sizeof(PackFooter), 1, fp) == 1 && memcmp(footer.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0;
+
+	// The index sits right before the footer
+	valid = valid && footer.count <= (uint64_t) size / sizeof(PackRecord) &&
+				footer.indexOffset + footer.count * sizeof(PackRecord) + sizeof(PackFooter) == (uint64_t) size;
+	if(valid)
+	{
+		pack = (Pack *) malloc(sizeof(Pack));
+		pack->count = footer.count;
+		pack->records = (PackRecord *) malloc(sizeof(PackRecord) * (pack->count + 1));
+
+		valid = fseeko(fp, footer.indexOffset, SEEK_SET) == 0 &&
+				fread(pack->records, sizeof(PackRecord), pack->count, fp) == pack->count;
+
+		for(size_t i = 0; valid && i < pack->count; ++i)
+			valid = pack->records[i].offset + pack->records[i].size <= footer.indexOffset;
+
+		if(!valid) { packClose(pack); pack = 0; }
+	}
+
+	if(!valid) printf("[Error] Pack %s has no valid index\n", _path);
+
+	fclose(fp);
+	return pack;
+}
+
+void packClose(Pack *_pack)
+{
+	free(_pack->records);
+	free(_pack);
+}
+
+size_t packGetCount(const Pack *_pack)
+{
+	return _pack->count;
+}
+
+const PackRecord *packGetRecord(const Pack *_pack, size_t _index)
+{
+	return (_index < _pack->count) ? _pack->records + _index : 0;
+}
+
+PackWriter *packCreate(const char *_path, size_t _recordSize, size_t _capacity, size_t _alignment)
+{
+	int fd = open(_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0) { printf("[Error] Pack %s can't be created\n", _path); return 0; }
+
+	PackWriter *writer = (PackWriter *) malloc(sizeof(PackWriter));
+	writer->path = strdup(_path);
+	writer->recordSize = _recordSize;
+	writer->stride = (_recordSize + _alignment - 1) & ~(_alignment - 1);
+	writer->capacity = _capacity;
+
+	// Reserve the blocks up front so the writes never extend the file
+	int res = fallocate(fd, 0, 0, writer->stride * _capacity);
+	if(res != 0 && errno != EOPNOTSUPP) printf("[Warning] Pack %s can't be preallocated\n", _path);
+
+	close(fd);
+	return writer;
+}
+
+bool packFinish(PackWriter *_writer, size_t _count)
+{
+	if(_count > _writer->capacity) _count = _writer->capacity;
+
+	int fd = open(_writer->path, O_WRONLY);
+	if(fd < 0) return false;
+
+	size_t indexSize = sizeof(PackRecord) * _count;
+	char *trailer = (char *) malloc(indexSize + sizeof(PackFooter));
+
+	PackRecord *records = (PackRecord *) trailer;
+	for(size_t i = 0; i < _count; ++i)
+	{
+		records[i].offset = packGetOffset(_writer, i);
+		records[i].size = _writer->recordSize;
+	}
+
+	PackFooter *footer = (PackFooter *) (trailer + indexSize);
+	footer->indexOffset = _writer->stride * _count;
+	footer->count = _count;
+	memcpy(footer->magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+
+	// Index and footer go right after the last record, the preallocated space beyond is released
+	size_t size = indexSize + sizeof(PackFooter);
+	bool ret = pwrite(fd, trailer, size, footer->indexOffset) == (ssize_t) size &&
+				ftruncate(fd, footer->indexOffset + size) == 0;
+
+	free(trailer);
+	close(fd);
+
+	if(!ret) printf("[Error] Pack %s index can't be written\n", _writer->path);
+	return ret;
+}
+
+void packDestroy(PackWriter *_writer)
+{
+	free(_writer->path);
+	free(_writer);
+}
+
+size_t packGetCapacity(const PackWriter *_writer)
+{
+	return _writer->capacity;
+}
+
+uint64_t packGetOffset(const PackWriter *_writer, size_t _index)
+{
+	return _writer->stride * _index;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <stddef.h> // size_t
+#include <stdint.h> // uint64_t
+
+// Packed record container: records stored back to back, followed by their index and a footer
+// closing the file, so records can be appended before the index is written
+struct PackRecord { uint64_t offset; uint64_t size; };
+struct PackFooter { uint64_t indexOffset; uint64_t count; char magic[8]; };
+
+const char PACK_MAGIC[8] = { 'C', 'P', 'A', 'C', 'K', 'I', 'D', 'X' };
+
+struct Pack;
+
+// Loads the whole index once, records are then read by offset without any metadata operation
+Pack *packOpen(const char *_path);
+void packClose(Pack *_pack);
+
+size_t packGetCount(const Pack *_pack);
+const PackRecord *packGetRecord(const Pack *_pack, size_t _index);
+
+// Append only writer, records have a fixed stride so their offsets are known before they are written.
+// The file is preallocated for the whole capacity, finishing writes the index and trims the unused space
+struct PackWriter;
+
+PackWriter *packCreate(const char *_path, size_t _recordSize, size_t _capacity, size_t _alignment);
+bool packFinish(PackWriter *_writer, size_t _count);
+void packDestroy(PackWriter *_writer);
+
+size_t packGetCapacity(const PackWriter *_writer);
+uint64_t packGetOffset(const PackWriter *_writer, size_t _index);
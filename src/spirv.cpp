@@ -0,0 +1,293 @@
+#include "spirv.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+const uint32_t SPIRV_MAGIC = 0x07230203;
+const size_t SPIRV_HEADER_WORDS = 5;
+
+enum SpirvOp
+{
+	SpirvOp_Name = 5,
+	SpirvOp_TypeBool = 20,
+	SpirvOp_TypeInt = 21,
+	SpirvOp_TypeFloat = 22,
+	SpirvOp_TypeVector = 23,
+	SpirvOp_TypeMatrix = 24,
+	SpirvOp_TypeArray = 28,
+	SpirvOp_TypeStruct = 30,
+	SpirvOp_TypePointer = 32,
+	SpirvOp_Constant = 43,
+	SpirvOp_SpecConstantTrue = 48,
+	SpirvOp_SpecConstantFalse = 49,
+	SpirvOp_SpecConstant = 50,
+	SpirvOp_FunctionCall = 57,
+	SpirvOp_Variable = 59,
+	SpirvOp_Load = 61,
+	SpirvOp_Store = 62,
+	SpirvOp_CopyMemory = 63,
+	SpirvOp_CopyMemorySized = 64,
+	SpirvOp_AccessChain = 65,
+	SpirvOp_InBoundsAccessChain = 66,
+	SpirvOp_PtrAccessChain = 67,
+	SpirvOp_ArrayLength = 68,
+	SpirvOp_InBoundsPtrAccessChain = 70,
+	SpirvOp_Decorate = 71,
+	SpirvOp_MemberDecorate = 72,
+	SpirvOp_CopyObject = 83,
+	SpirvOp_Select = 169,
+	SpirvOp_AtomicLoad = 227,
+	SpirvOp_AtomicStore = 228,
+	SpirvOp_AtomicExchange = 229,
+	SpirvOp_AtomicXor = 242,
+	SpirvOp_Phi = 245,
+	SpirvOp_AtomicFlagTestAndSet = 318,
+	SpirvOp_AtomicFlagClear = 319,
+	SpirvOp_AtomicFAddEXT = 6035,
+};
+
+enum SpirvDecoration { SpirvDecoration_SpecId = 1, SpirvDecoration_ArrayStride = 6, SpirvDecoration_MatrixStride = 7,
+						SpirvDecoration_Binding = 33, SpirvDecoration_DescriptorSet = 34, SpirvDecoration_Offset = 35 };
+const uint32_t SPIRV_STORAGE_PUSH_CONSTANT = 9;
+
+
+static void spirvAccess(const int *_bindings, uint32_t _bound, uint32_t _id, unsigned char *_access, int _count, unsigned char _flags)
+{
+	int binding = (_id < _bound) ? _bindings[_id] : -1;
+	if(binding >= 0 && binding < _count) _access[binding] |= _flags;
+}
+
+bool spirvReflectAccess(const void *_code, size_t _size, unsigned char *_access, int _count, const char **_names)
+{
+	const uint32_t *words = (const uint32_t *) _code;
+	size_t count = _size / sizeof(uint32_t);
+	if(count < SPIRV_HEADER_WORDS || words[0] != SPIRV_MAGIC) return false;
+
+	// Every id maps to the binding its pointer comes from, -1 otherwise. Decorations come first in a module,
+	// and ids are defined before they are used, so a single pass follows pointers from their variable
+	uint32_t bound = words[3];
+	int *bindings = (int *) malloc(sizeof(int) * bound);
+	unsigned *sets = (unsigned *) malloc(sizeof(unsigned) * bound);
+	int *decorated = (int *) malloc(sizeof(int) * bound);
+	const char **names = (const char **) malloc(sizeof(const char *) * bound);
+	for(uint32_t i = 0; i < bound; ++i) { bindings[i] = -1; sets[i] = 0; decorated[i] = -1; names[i] = 0; }
+
+	bool valid = true;
+	for(size_t i = SPIRV_HEADER_WORDS; i < count;)
+	{
+		uint32_t length = words[i] >> 16;
+		uint32_t opcode = words[i] & 0xFFFF;
+		if(length == 0 || i + length > count) { valid = false; break; }
+		const uint32_t *op = words + i;
+		i += length;
+
+		switch(opcode)
+		{
+			case SpirvOp_Name:
+				if(length >= 3 && op[1] < bound && memchr(op + 2, 0, (length - 2) * sizeof(uint32_t))) names[op[1]] = (const char *) (op + 2);
+				break;
+			case SpirvOp_Decorate:
+				if(length >= 4 && op[1] < bound && op[2] == SpirvDecoration_Binding) decorated[op[1]] = (int) op[3];
+				if(length >= 4 && op[1] < bound && op[2] == SpirvDecoration_DescriptorSet) sets[op[1]] = op[3];
+				break;
+			case SpirvOp_Variable:
+				if(length >= 4 && op[2] < bound && sets[op[2]] == 0) bindings[op[2]] = decorated[op[2]];
+				if(length >= 4 && op[2] < bound && _names && bindings[op[2]] >= 0 && bindings[op[2]] < _count && !_names[bindings[op[2]]])
+					_names[bindings[op[2]]] = names[op[2]];
+				break;
+			case SpirvOp_AccessChain:
+			case SpirvOp_InBoundsAccessChain:
+			case SpirvOp_PtrAccessChain:
+			case SpirvOp_InBoundsPtrAccessChain:
+			case SpirvOp_CopyObject:
+				if(length >= 4 && op[2] < bound && op[3] < bound) bindings[op[2]] = bindings[op[3]];
+				break;
+			case SpirvOp_Load:
+			case SpirvOp_ArrayLength:
+			case SpirvOp_AtomicLoad:
+				if(length >= 4) spirvAccess(bindings, bound, op[3], _access, _count, SpirvAccess_Read);
+				break;
+			case SpirvOp_Store:
+			case SpirvOp_AtomicStore:
+			case SpirvOp_AtomicFlagClear:
+				if(length >= 2) spirvAccess(bindings, bound, op[1], _access, _count, SpirvAccess_Write);
+				break;
+			case SpirvOp_CopyMemory:
+			case SpirvOp_CopyMemorySized:
+				if(length >= 3) spirvAccess(bindings, bound, op[1], _access, _count, SpirvAccess_Write);
+				if(length >= 3) spirvAccess(bindings, bound, op[2], _access, _count, SpirvAccess_Read);
+				break;
+			case SpirvOp_FunctionCall:
+				for(uint32_t a = 4; a < length; ++a) spirvAccess(bindings, bound, op[a], _access, _count, SpirvAccess_ReadWrite);
+				break;
+			case SpirvOp_Select:
+			case SpirvOp_Phi:
+				// Merged pointers are not followed any further, whatever they point to is assumed read and written
+				for(uint32_t a = 3; a < length; ++a) spirvAccess(bindings, bound, op[a], _access, _count, SpirvAccess_ReadWrite);
+				break;
+			default:
+				bool atomic = (opcode >= SpirvOp_AtomicExchange && opcode <= SpirvOp_AtomicXor) ||
+								opcode == SpirvOp_AtomicFlagTestAndSet || opcode == SpirvOp_AtomicFAddEXT;
+				if(atomic && length >= 4) spirvAccess(bindings, bound, op[3], _access, _count, SpirvAccess_ReadWrite);
+				break;
+		}
+	}
+
+	free(bindings);
+	free(sets);
+	free(decorated);
+	free(names);
+
+	return valid;
+}
+
+int spirvReflectConstants(const void *_code, size_t _size, SpirvConstant *_constants, int _count)
+{
+	const uint32_t *words = (const uint32_t *) _code;
+	size_t count = _size / sizeof(uint32_t);
+	if(count < SPIRV_HEADER_WORDS || words[0] != SPIRV_MAGIC) return -1;
+
+	// Types and decorations are declared before the constants using them
+	uint32_t bound = words[3];
+	int64_t *specIds = (int64_t *) malloc(sizeof(int64_t) * bound);
+	uint32_t *types = (uint32_t *) malloc(sizeof(uint32_t) * bound);
+	const char **names = (const char **) malloc(sizeof(const char *) * bound);
+	for(uint32_t i = 0; i < bound; ++i) { specIds[i] = -1; types[i] = 0; names[i] = 0; }
+
+	int found = 0;
+	for(size_t i = SPIRV_HEADER_WORDS; i < count;)
+	{
+		uint32_t length = words[i] >> 16;
+		uint32_t opcode = words[i] & 0xFFFF;
+		if(length == 0 || i + length > count) { found = -1; break; }
+		const uint32_t *op = words + i;
+		i += length;
+
+		switch(opcode)
+		{
+			case SpirvOp_Name:
+				if(length >= 3 && op[1] < bound && memchr(op + 2, 0, (length - 2) * sizeof(uint32_t))) names[op[1]] = (const char *) (op + 2);
+				break;
+			case SpirvOp_Decorate:
+				if(length >= 4 && op[1] < bound && op[2] == SpirvDecoration_SpecId) specIds[op[1]] = op[3];
+				break;
+			case SpirvOp_TypeBool:
+			case SpirvOp_TypeInt:
+			case SpirvOp_TypeFloat:
+				// Type, width and signedness packed together, the width is 1 for booleans
+				if(length >= 2 && op[1] < bound)
+				{
+					uint32_t width = (opcode == SpirvOp_TypeBool) ? 1 : (length >= 3) ? op[2] : 0;
+					SpirvConstantType type = (opcode == SpirvOp_TypeBool) ? SpirvConstant_Bool : (opcode == SpirvOp_TypeFloat) ? SpirvConstant_Float :
+											(length >= 4 && op[3]) ? SpirvConstant_Int : SpirvConstant_Uint;
+					types[op[1]] = (width << 8) | (type + 1);
+				}
+				break;
+			case SpirvOp_SpecConstantTrue:
+			case SpirvOp_SpecConstantFalse:
+			case SpirvOp_SpecConstant:
+				// Constants without SpecId are only intermediate values of other specialization constants
+				if(length >= 3 && op[1] < bound && op[2] < bound && specIds[op[2]] >= 0 && types[op[1]] != 0)
+				{
+					if(found < _count)
+					{
+						SpirvConstant *constant = _constants + found;
+						constant->id = (unsigned) specIds[op[2]];
+						constant->type = (SpirvConstantType) ((types[op[1]] & 0xFF) - 1);
+						constant->width = types[op[1]] >> 8;
+						constant->name = names[op[2]];
+					}
+					++found;
+				}
+				break;
+		}
+	}
+
+	free(specIds);
+	free(types);
+	free(names);
+
+	return found;
+}
+
+int spirvReflectPushConstants(const void *_code, size_t _size)
+{
+	const uint32_t *words = (const uint32_t *) _code;
+	size_t count = _size / sizeof(uint32_t);
+	if(count < SPIRV_HEADER_WORDS || words[0] != SPIRV_MAGIC) return -1;
+
+	// Sizes of the types in bytes, member offsets are decorated before their struct is declared
+	uint32_t bound = words[3];
+	uint32_t *sizes = (uint32_t *) malloc(sizeof(uint32_t) * bound);
+	uint32_t *strides = (uint32_t *) malloc(sizeof(uint32_t) * bound);
+	uint32_t *values = (uint32_t *) malloc(sizeof(uint32_t) * bound);
+	uint32_t *offsets = (uint32_t *) malloc(sizeof(uint32_t) * (count / 4 * 3 + 3));
+	for(uint32_t i = 0; i < bound; ++i) { sizes[i] = 0; strides[i] = 0; values[i] = 0; }
+
+	int found = 0;
+	size_t offsetCount = 0;
+	for(size_t i = SPIRV_HEADER_WORDS; i < count;)
+	{
+		uint32_t length = words[i] >> 16;
+		uint32_t opcode = words[i] & 0xFFFF;
+		if(length == 0 || i + length > count) { found = -1; break; }
+		const uint32_t *op = words + i;
+		i += length;
+
+		if(length < 3 || op[1] >= bound) continue;
+		switch(opcode)
+		{
+			case SpirvOp_Decorate:
+				if(length >= 4 && (op[2] == SpirvDecoration_ArrayStride || op[2] == SpirvDecoration_MatrixStride)) strides[op[1]] = op[3];
+				break;
+			case SpirvOp_MemberDecorate:
+				if(length >= 5 && op[3] == SpirvDecoration_Offset)
+				{
+					uint32_t *entry = offsets + 3 * offsetCount++;
+					entry[0] = op[1]; entry[1] = op[2]; entry[2] = op[4];
+				}
+				break;
+			case SpirvOp_TypeInt:
+			case SpirvOp_TypeFloat:
+				sizes[op[1]] = op[2] / 8;
+				break;
+			case SpirvOp_TypeVector:
+				if(length >= 4 && op[2] < bound) sizes[op[1]] = sizes[op[2]] * op[3];
+				break;
+			case SpirvOp_TypeMatrix:
+				if(length >= 4 && op[2] < bound) sizes[op[1]] = sizes[op[2]] * op[3];
+				break;
+			case SpirvOp_Constant:
+				if(length >= 4 && op[2] < bound) values[op[2]] = op[3];
+				break;
+			case SpirvOp_TypeArray:
+				if(length >= 4 && op[2] < bound && op[3] < bound)
+					sizes[op[1]] = (strides[op[1]] ? strides[op[1]] : sizes[op[2]]) * values[op[3]];
+				break;
+			case SpirvOp_TypeStruct:
+				// Members without an offset are packed after the previous one
+				for(uint32_t m = 2, end = 0; m < length; ++m)
+				{
+					uint32_t offset = end;
+					for(size_t o = 0; o < offsetCount; ++o)
+						if(offsets[3 * o] == op[1] && offsets[3 * o + 1] == m - 2) offset = offsets[3 * o + 2];
+					end = offset + ((op[m] < bound) ? sizes[op[m]] : 0);
+					if(end > sizes[op[1]]) sizes[op[1]] = end;
+				}
+				break;
+			case SpirvOp_TypePointer:
+				if(length >= 4 && op[3] < bound) sizes[op[1]] = sizes[op[3]];
+				break;
+			case SpirvOp_Variable:
+				if(length >= 4 && op[3] == SPIRV_STORAGE_PUSH_CONSTANT && (int) sizes[op[1]] > found) found = sizes[op[1]];
+				break;
+		}
+	}
+
+	free(sizes);
+	free(strides);
+	free(values);
+	free(offsets);
+
+	return found;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <stddef.h> // size_t
+
+enum SpirvAccess { SpirvAccess_None = 0, SpirvAccess_Read = 0x1, SpirvAccess_Write = 0x2, SpirvAccess_ReadWrite = 0x3 };
+
+// Minimal SPIR-V reflection, accumulates how the module accesses the resources of descriptor set 0.
+// Loads, stores and atomics are followed through access chains, pointers handed to functions count as read and write.
+// Names, when asked for, point into the module at the debug name of the first variable of each binding
+bool spirvReflectAccess(const void *_code, size_t _size, unsigned char *_access, int _count, const char **_names = 0);
+
+enum SpirvConstantType { SpirvConstant_Bool, SpirvConstant_Int, SpirvConstant_Uint, SpirvConstant_Float };
+
+struct SpirvConstant
+{
+	unsigned id;
+	SpirvConstantType type;
+	unsigned width;
+	const char *name;
+};
+
+// Specialization constants of the module, workgroup sizes given with local_size_x_id included. Names point into the module
+// when it has debug names. Returns the number of constants found, up to _count of them are stored, -1 for an invalid module
+int spirvReflectConstants(const void *_code, size_t _size, SpirvConstant *_constants, int _count);
+
+// Size in bytes of the push constant block the module reads, 0 without one, -1 for an invalid module.
+// Scalars, vectors, matrices, arrays and structs are sized from their offsets and strides
+int spirvReflectPushConstants(const void *_code, size_t _size);
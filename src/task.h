@@ -0,0 +1,16 @@
+#pragma once
+
+// Worker pool running CPU tasks next to the executor thread, tasks are tracked by the group they were submitted with
+struct TaskPool;
+struct TaskGroup { int pending; };
+
+typedef void (*TaskFunction)(void *_data);
+
+// Zero threads picks one worker per available core but the calling one
+TaskPool *taskCreatePool(int _threads);
+void taskDestroyPool(TaskPool *_pool);
+int taskGetThreadCount(const TaskPool *_pool);
+
+// Tasks run inline when the queue is full
+void taskSubmit(TaskPool *_pool, TaskGroup *_group, TaskFunction _function, void *_data);
+void taskWait(TaskPool *_pool, TaskGroup *_group);
@@ -0,0 +1,131 @@
+#include "task.h"
+#include <string.h>
+#include <malloc.h>
+#include <unistd.h>
+#include <pthread.h>
+
+
+const int TASK_MAX_THREADS = 64;
+const int TASK_MAX_QUEUE = 1024;
+
+struct Task
+{
+	TaskFunction function;
+	void *data;
+	TaskGroup *group;
+};
+
+struct TaskPool
+{
+	pthread_t threads[TASK_MAX_THREADS];
+	int threadCount;
+	pthread_mutex_t mutex;
+	pthread_cond_t ready;
+	pthread_cond_t done;
+	Task queue[TASK_MAX_QUEUE];
+	int head, count;
+	bool exit;
+};
+
+
+static void *taskWorker(void *_data)
+{
+	TaskPool *pool = (TaskPool *) _data;
+
+	pthread_mutex_lock(&pool->mutex);
+	for(;;)
+	{
+		while(pool->count == 0 && !pool->exit) pthread_cond_wait(&pool->ready, &pool->mutex);
+		if(pool->count == 0) break;
+
+		Task task = pool->queue[pool->head];
+		pool->head = (pool->head + 1) % TASK_MAX_QUEUE;
+		--pool->count;
+
+		pthread_mutex_unlock(&pool->mutex);
+		task.function(task.data);
+		pthread_mutex_lock(&pool->mutex);
+
+		if(--task.group->pending == 0) pthread_cond_broadcast(&pool->done);
+	}
+	pthread_mutex_unlock(&pool->mutex);
+
+	return 0;
+}
+
+TaskPool *taskCreatePool(int _threads)
+{
+	if(_threads <= 0)
+	{
+		long cores = sysconf(_SC_NPROCESSORS_ONLN);
+		_threads = (cores > 1) ? int(cores - 1) : 1;
+	}
+	if(_threads > TASK_MAX_THREADS) _threads = TASK_MAX_THREADS;
+
+	TaskPool *pool = (TaskPool *) malloc(sizeof(TaskPool));
+	memset(pool, 0, sizeof(TaskPool));
+	pthread_mutex_init(&pool->mutex, 0);
+	pthread_cond_init(&pool->ready, 0);
+	pthread_cond_init(&pool->done, 0);
+
+	for(int i = 0; i < _threads; ++i)
+	{
+		if(pthread_create(pool->threads + i, 0, taskWorker, pool) != 0) break;
+		++pool->threadCount;
+	}
+
+	if(pool->threadCount == 0)
+	{
+		taskDestroyPool(pool);
+		pool = 0;
+	}
+
+	return pool;
+}
+
+void taskDestroyPool(TaskPool *_pool)
+{
+	// Workers drain the queue before leaving
+	pthread_mutex_lock(&_pool->mutex);
+	_pool->exit = true;
+	pthread_cond_broadcast(&_pool->ready);
+	pthread_mutex_unlock(&_pool->mutex);
+
+	for(int i = 0; i < _pool->threadCount; ++i) pthread_join(_pool->threads[i], 0);
+
+	pthread_cond_destroy(&_pool->done);
+	pthread_cond_destroy(&_pool->ready);
+	pthread_mutex_destroy(&_pool->mutex);
+	free(_pool);
+}
+
+int taskGetThreadCount(const TaskPool *_pool)
+{
+	return _pool->threadCount;
+}
+
+void taskSubmit(TaskPool *_pool, TaskGroup *_group, TaskFunction _function, void *_data)
+{
+	pthread_mutex_lock(&_pool->mutex);
+	bool queued = _pool->count < TASK_MAX_QUEUE;
+	if(queued)
+	{
+		Task *task = _pool->queue + (_pool->head + _pool->count) % TASK_MAX_QUEUE;
+		task->function = _function;
+		task->data = _data;
+		task->group = _group;
+		++_pool->count;
+		++_group->pending;
+		pthread_cond_signal(&_pool->ready);
+	}
+	pthread_mutex_unlock(&_pool->mutex);
+
+	if(!queued) _function(_data);
+}
+
+void taskWait(TaskPool *_pool, TaskGroup *_group)
+{
+	pthread_mutex_lock(&_pool->mutex);
+	while(_group->pending > 0) pthread_cond_wait(&_pool->done, &_pool->mutex);
+	pthread_mutex_unlock(&_pool->mutex);
+}